@@ -0,0 +1,165 @@
+/*****************************************************************************
+ *  CP2K: A general program to perform molecular dynamics simulations        *
+ *  Copyright (C) 2000 - 2014 the CP2K developers group                      *
+ *****************************************************************************/
+
+/* Hardware performance counters of the calling thread, read through the
+   Linux perf_event interface. Used by timings.F to accumulate the counters
+   per timer region.
+
+   The counters of a thread are opened as one group, so that they are
+   scheduled together and can be read with a single read() call. If the
+   kernel multiplexes the group with other events, the counts are scaled by
+   the fraction of the time it was actually counting. This is done for the
+   increments between two reads, with the increments of the enabled and
+   running times, so that a region is scaled with its own fraction and not
+   with that of the whole run. An interval in which the group did not run at
+   all adds no counts.
+   The groups of all threads are recorded, so that they can be closed
+   together by the master thread when the timers are released.
+   On other systems, or if the kernel refuses the counters (e.g. due to
+   /proc/sys/kernel/perf_event_paranoid), no counters are available. */
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/* has to match num_hw_counters in timings_base_type.F */
+#define NUM_COUNTERS 3
+
+#if defined(__linux__)
+static const uint64_t counter_config[NUM_COUNTERS] = {
+   PERF_COUNT_HW_CPU_CYCLES,
+   PERF_COUNT_HW_INSTRUCTIONS,
+   PERF_COUNT_HW_CACHE_MISSES   /* usually misses of the last level cache */
+};
+
+/* groups of all threads, and a generation that is incremented when they are
+   closed, so that the threads know that their descriptors are stale */
+#define MAX_GROUPS 4096
+static int all_fd[MAX_GROUPS][NUM_COUNTERS];
+static int num_groups = 0;
+static int generation = 0;
+
+static __thread int counter_fd[NUM_COUNTERS] = {-1, -1, -1};
+static __thread int counter_generation = -1;
+
+/* last raw reading of the calling thread and the scaled counts up to it */
+static __thread uint64_t last_count[NUM_COUNTERS], last_enabled, last_running;
+static __thread double scaled_count[NUM_COUNTERS];
+
+static int open_counter(uint64_t config, int group_fd){
+   struct perf_event_attr attr;
+
+   memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = PERF_TYPE_HARDWARE;
+   attr.config = config;
+   attr.disabled = (group_fd == -1);
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                      PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+   /* calling thread, any cpu */
+   return (int) syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+#endif
+
+/* Opens and starts the counters of the calling thread.
+   Returns the number of counters, or zero if they are not available. */
+int cp_perf_counters_open(void){
+#if defined(__linux__)
+   int i, slot;
+
+   if (counter_fd[0] >= 0 && counter_generation == generation) return NUM_COUNTERS;
+
+   for (i = 0; i < NUM_COUNTERS; i++) counter_fd[i] = -1;
+   for (i = 0; i < NUM_COUNTERS; i++){
+      counter_fd[i] = open_counter(counter_config[i], counter_fd[0]);
+      if (counter_fd[i] < 0){
+         while (--i >= 0){
+            close(counter_fd[i]);
+            counter_fd[i] = -1;
+         }
+         return 0;
+      }
+   }
+
+   /* the descriptors of a group that can not be recorded would leak */
+   slot = __sync_fetch_and_add(&num_groups, 1);
+   if (slot >= MAX_GROUPS){
+      for (i = NUM_COUNTERS - 1; i >= 0; i--){
+         close(counter_fd[i]);
+         counter_fd[i] = -1;
+      }
+      return 0;
+   }
+   for (i = 0; i < NUM_COUNTERS; i++) all_fd[slot][i] = counter_fd[i];
+   counter_generation = generation;
+
+   for (i = 0; i < NUM_COUNTERS; i++){
+      last_count[i] = 0;
+      scaled_count[i] = 0.0;
+   }
+   last_enabled = last_running = 0;
+
+   ioctl(counter_fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+   ioctl(counter_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+   return NUM_COUNTERS;
+#else
+   return 0;
+#endif
+}
+
+/* Reads the counters of the calling thread into values, the counts since
+   the counters were opened, scaled for multiplexing.
+   Returns zero on success. */
+int cp_perf_counters_read(int64_t *values){
+#if defined(__linux__)
+   uint64_t buffer[3 + NUM_COUNTERS], enabled, running;
+   double scale = 1.0;
+   int i;
+
+   if (counter_fd[0] < 0 || counter_generation != generation) return -1;
+   if (read(counter_fd[0], buffer, sizeof(buffer)) != (ssize_t) sizeof(buffer)) return -1;
+   /* number of counters, time enabled, time running, counters */
+   enabled = buffer[1] - last_enabled;
+   running = buffer[2] - last_running;
+   if (running > 0){
+      if (running < enabled) scale = (double) enabled/(double) running;
+      for (i = 0; i < NUM_COUNTERS; i++)
+         scaled_count[i] += scale*(double) (buffer[3 + i] - last_count[i]);
+   }
+   last_enabled = buffer[1];
+   last_running = buffer[2];
+   for (i = 0; i < NUM_COUNTERS; i++){
+      last_count[i] = buffer[3 + i];
+      values[i] = (int64_t) scaled_count[i];
+   }
+   return 0;
+#else
+   (void) values;
+   return -1;
+#endif
+}
+
+/* Stops and closes the counters of all threads, to be called by one thread
+   while the others do not use the counters. */
+void cp_perf_counters_close(void){
+#if defined(__linux__)
+   int i, j, n;
+
+   n = num_groups < MAX_GROUPS ? num_groups : MAX_GROUPS;
+   for (i = 0; i < n; i++)
+      for (j = NUM_COUNTERS - 1; j >= 0; j--) close(all_fd[i][j]);
+   num_groups = 0;
+   generation++;
+#endif
+}
@@ -0,0 +1,453 @@
+/*****************************************************************************
+ *  CP2K: A general program to perform molecular dynamics simulations        *
+ *  Copyright (C) 2000 - 2014 the CP2K developers group                      *
+ *****************************************************************************/
+
+/* Sampling timer of the calling thread, used by the sampling profiler of
+   timings.F.
+
+   Every thread gets its own timer on its CPU time clock, which sends SIGPROF
+   to that very thread. The signal handler records the interrupted program
+   counter into one of two thread local buffers. timings.F collects the
+   samples whenever the timer call stack changes: the buffers are swapped
+   atomically, so a signal arriving meanwhile goes into the other buffer and
+   is not lost. The samples are counted by thread, node of the call tree of
+   the timed routines and program counter.
+
+   The program counters are only resolved to their native functions, the
+   leaves of the stacks, when the report asks for the frames. This is done
+   with backtrace_symbols, which only knows the symbols of the dynamic symbol
+   table. Functions of an executable that is not linked with -rdynamic appear
+   as file+offset, which addr2line resolves. */
+
+#if defined(__linux__)
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <execinfo.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+/* samples that do not fit into the buffer are only counted */
+#define PROF_BUFFER 256
+#define MAX_TIMERS 4096
+
+struct prof_buffer {
+   volatile sig_atomic_t nsamples, nlost;
+   void *pc[PROF_BUFFER];
+   int weight[PROF_BUFFER];
+};
+
+static __thread struct prof_buffer prof_buffers[2];
+static __thread volatile sig_atomic_t prof_active = 0;
+static __thread int prof_running = 0, prof_generation = -1;
+static __thread timer_t prof_timer;
+
+/* timers of all threads, so that they can be stopped together */
+static timer_t all_timers[MAX_TIMERS];
+static int num_timers = 0;
+static int generation = 0;
+
+/* samples by thread, node of the call tree and program counter */
+struct prof_entry {
+   int ithread, node;
+   void *pc;
+   long samples;
+};
+
+static struct prof_entry *entries = NULL;
+static int num_entries = 0, max_entries = 0;
+static int *entry_hash = NULL, hash_size = 0;
+static volatile int table_lock = 0;
+
+/* native frames by thread, node and name of the function, built from the
+   entries by resolve_frames, name is -1 if the function is unknown */
+struct prof_frame {
+   int ithread, node, name;
+   long samples;
+};
+
+static struct prof_frame *frames = NULL;
+static int num_frames = 0;
+static char **names = NULL;
+static int num_names = 0;
+
+static void *context_pc(void *context){
+   ucontext_t *uc = (ucontext_t *) context;
+
+#if defined(__x86_64__)
+   return (void *) uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+   return (void *) uc->uc_mcontext.gregs[REG_EIP];
+#elif defined(__aarch64__)
+   return (void *) uc->uc_mcontext.pc;
+#elif defined(__powerpc64__)
+   return (void *) uc->uc_mcontext.gp_regs[32];
+#else
+   (void) uc;
+   return NULL;
+#endif
+}
+
+static void prof_handler(int sig, siginfo_t *info, void *context){
+   struct prof_buffer *buffer = &prof_buffers[prof_active];
+   int weight, n;
+
+   (void) sig;
+   /* expirations that were merged into this signal count as well */
+   weight = 1 + (info->si_code == SI_TIMER ? info->si_overrun : 0);
+   n = buffer->nsamples;
+   if (n < PROF_BUFFER){
+      buffer->pc[n] = context_pc(context);
+      buffer->weight[n] = weight;
+      buffer->nsamples = n + 1;
+   } else {
+      buffer->nlost += weight;
+   }
+}
+
+static int entry_slot(int ithread, int node, void *pc){
+   unsigned long h = ((unsigned long) ithread*131071UL + (unsigned long) node)*8191UL +
+                     ((unsigned long) (uintptr_t) pc >> 2);
+   return (int) (h % (unsigned long) hash_size);
+}
+
+/* Adds samples to the entry of thread, node and program counter, the lock has
+   to be held. Returns zero on success. */
+static int add_entry(int ithread, int node, void *pc, long samples){
+   int h, i;
+
+   if (2*(num_entries + 1) > hash_size){
+      int new_size = 2*hash_size + 1024;
+      int *new_hash = (int *) malloc(new_size*sizeof(int));
+      if (!new_hash) return -1;
+      free(entry_hash);
+      entry_hash = new_hash;
+      hash_size = new_size;
+      for (h = 0; h < hash_size; h++) entry_hash[h] = -1;
+      for (i = 0; i < num_entries; i++){
+         h = entry_slot(entries[i].ithread, entries[i].node, entries[i].pc);
+         while (entry_hash[h] >= 0) h = (h + 1) % hash_size;
+         entry_hash[h] = i;
+      }
+   }
+
+   h = entry_slot(ithread, node, pc);
+   while ((i = entry_hash[h]) >= 0){
+      if (entries[i].ithread == ithread && entries[i].node == node && entries[i].pc == pc){
+         entries[i].samples += samples;
+         return 0;
+      }
+      h = (h + 1) % hash_size;
+   }
+
+   if (num_entries == max_entries){
+      struct prof_entry *new_entries = (struct prof_entry *)
+         realloc(entries, (2*max_entries + 1024)*sizeof(struct prof_entry));
+      if (!new_entries) return -1;
+      entries = new_entries;
+      max_entries = 2*max_entries + 1024;
+   }
+   entries[num_entries].ithread = ithread;
+   entries[num_entries].node = node;
+   entries[num_entries].pc = pc;
+   entries[num_entries].samples = samples;
+   entry_hash[h] = num_entries++;
+   return 0;
+}
+
+/* Name of the native function of a symbol of backtrace_symbols, NULL if it is
+   not known. The result has to be freed. */
+static char *symbol_name(char *symbol){
+   char *name, *open, *plus, *close, *base;
+
+   /* "file(function+0x12) [0x...]" or "file(+0x1234) [0x...]" */
+   name = NULL;
+   open = strchr(symbol, '(');
+   plus = open ? strchr(open, '+') : NULL;
+   close = open ? strchr(open, ')') : NULL;
+   if (open && plus && close && plus < close){
+      if (plus > open + 1){
+         name = strndup(open + 1, plus - open - 1);
+      } else {
+         *open = '\0';
+         base = strrchr(symbol, '/');
+         base = base ? base + 1 : symbol;
+         name = (char *) malloc(strlen(base) + (close - plus) + 1);
+         if (name) sprintf(name, "%s%.*s", base, (int) (close - plus), plus);
+      }
+   }
+   return name;
+}
+
+static int compare_pc(const void *a, const void *b){
+   uintptr_t x = (uintptr_t) *(void * const *) a, y = (uintptr_t) *(void * const *) b;
+   return (x > y) - (x < y);
+}
+
+static int compare_name(const void *a, const void *b){
+   return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+static int compare_frame(const void *a, const void *b){
+   const struct prof_frame *x = (const struct prof_frame *) a, *y = (const struct prof_frame *) b;
+
+   if (x->ithread != y->ithread) return x->ithread < y->ithread ? -1 : 1;
+   if (x->node != y->node) return x->node < y->node ? -1 : 1;
+   return (x->name > y->name) - (x->name < y->name);
+}
+
+static void free_frames(void){
+   int i;
+
+   for (i = 0; i < num_names; i++) free(names[i]);
+   free(names);
+   free(frames);
+   names = NULL;
+   frames = NULL;
+   num_names = num_frames = 0;
+}
+
+/* Resolves the program counters of the entries and sums the samples of the
+   entries with the same thread, node and function into frames. Only called
+   for the report, the lock has to be held. Returns zero on success. */
+static int resolve_frames(void){
+   void **pcs;
+   char **symbols, **pc_names, **sorted;
+   int *pc_name_id;
+   int i, j, n, npcs, status;
+
+   free_frames();
+   if (num_entries == 0) return 0;
+
+   /* the distinct program counters, sorted */
+   pcs = (void **) malloc(num_entries*sizeof(void *));
+   if (!pcs) return -1;
+   for (i = 0; i < num_entries; i++) pcs[i] = entries[i].pc;
+   qsort(pcs, num_entries, sizeof(void *), compare_pc);
+   npcs = 0;
+   for (i = 0; i < num_entries; i++){
+      if (npcs == 0 || pcs[i] != pcs[npcs - 1]) pcs[npcs++] = pcs[i];
+   }
+
+   status = -1;
+   symbols = NULL;
+   pc_names = sorted = NULL;
+   pc_name_id = NULL;
+   symbols = backtrace_symbols(pcs, npcs);
+   pc_names = (char **) calloc(npcs, sizeof(char *));
+   sorted = (char **) malloc(npcs*sizeof(char *));
+   pc_name_id = (int *) malloc(npcs*sizeof(int));
+   names = (char **) malloc(npcs*sizeof(char *));
+   frames = (struct prof_frame *) malloc(num_entries*sizeof(struct prof_frame));
+   if (!symbols || !pc_names || !sorted || !pc_name_id || !names || !frames) goto cleanup;
+
+   /* one name per function, several program counters share it */
+   n = 0;
+   for (i = 0; i < npcs; i++){
+      pc_names[i] = symbol_name(symbols[i]);
+      if (pc_names[i]) sorted[n++] = pc_names[i];
+   }
+   qsort(sorted, n, sizeof(char *), compare_name);
+   for (i = 0; i < n; i++){
+      if (num_names == 0 || strcmp(sorted[i], names[num_names - 1]) != 0){
+         names[num_names] = strdup(sorted[i]);
+         if (!names[num_names]) goto cleanup;
+         num_names++;
+      }
+   }
+   for (i = 0; i < npcs; i++){
+      char **found = pc_names[i] ? (char **)
+         bsearch(&pc_names[i], names, num_names, sizeof(char *), compare_name) : NULL;
+      pc_name_id[i] = found ? (int) (found - names) : -1;
+   }
+
+   for (i = 0; i < num_entries; i++){
+      void **found = (void **) bsearch(&entries[i].pc, pcs, npcs, sizeof(void *), compare_pc);
+      frames[i].ithread = entries[i].ithread;
+      frames[i].node = entries[i].node;
+      frames[i].name = pc_name_id[found - pcs];
+      frames[i].samples = entries[i].samples;
+   }
+   qsort(frames, num_entries, sizeof(struct prof_frame), compare_frame);
+   for (i = 0; i < num_entries; i++){
+      j = num_frames - 1;
+      if (num_frames > 0 && compare_frame(&frames[j], &frames[i]) == 0){
+         frames[j].samples += frames[i].samples;
+      } else {
+         frames[num_frames++] = frames[i];
+      }
+   }
+   status = 0;
+
+cleanup:
+   if (pc_names) for (i = 0; i < npcs; i++) free(pc_names[i]);
+   free(pc_names);
+   free(sorted);
+   free(pc_name_id);
+   free(symbols);
+   free(pcs);
+   if (status != 0) free_frames();
+   return status;
+}
+#endif
+
+/* Starts the sampling timer of the calling thread with the given interval.
+   Returns zero on success. */
+int cp_prof_start(int interval_us){
+#if defined(__linux__)
+   static int handler_installed = 0;
+   struct sigaction action;
+   struct sigevent event;
+   struct itimerspec spec;
+   int slot;
+
+   if (prof_running && prof_generation == generation) return 0;
+   if (interval_us <= 0) return -1;
+
+   if (!handler_installed){
+      memset(&action, 0, sizeof(action));
+      action.sa_sigaction = prof_handler;
+      /* interrupted system calls, e.g. in MPI, are restarted */
+      action.sa_flags = SA_RESTART | SA_SIGINFO;
+      sigemptyset(&action.sa_mask);
+      if (sigaction(SIGPROF, &action, NULL) != 0) return -1;
+      handler_installed = 1;
+   }
+
+   memset(&event, 0, sizeof(event));
+   event.sigev_notify = SIGEV_THREAD_ID;
+   event.sigev_signo = SIGPROF;
+   event.sigev_notify_thread_id = (pid_t) syscall(SYS_gettid);
+   if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &prof_timer) != 0) return -1;
+
+   slot = __sync_fetch_and_add(&num_timers, 1);
+   if (slot >= MAX_TIMERS){
+      timer_delete(prof_timer);
+      return -1;
+   }
+   all_timers[slot] = prof_timer;
+
+   /* samples left over from a previous run are dropped */
+   prof_buffers[0].nsamples = prof_buffers[0].nlost = 0;
+   prof_buffers[1].nsamples = prof_buffers[1].nlost = 0;
+
+   spec.it_interval.tv_sec = interval_us / 1000000;
+   spec.it_interval.tv_nsec = (interval_us % 1000000) * 1000L;
+   spec.it_value = spec.it_interval;
+   if (timer_settime(prof_timer, 0, &spec, NULL) != 0) return -1;
+
+   prof_running = 1;
+   prof_generation = generation;
+   return 0;
+#else
+   (void) interval_us;
+   return -1;
+#endif
+}
+
+/* Collects the samples of the calling thread since the last call and
+   attributes them to the given node of the call tree of thread ithread,
+   or drops them if node is zero. Returns the number of samples without a
+   program counter, which are left to the caller. Only the program counters
+   are stored, they are resolved when the report asks for the frames. */
+int cp_prof_collect(int ithread, int node){
+#if defined(__linux__)
+   struct prof_buffer *buffer;
+   int ticks, i, n;
+
+   if (!prof_running || prof_generation != generation) return 0;
+
+   /* from now on the handler writes into the other buffer */
+   buffer = &prof_buffers[__atomic_exchange_n(&prof_active, 1 - prof_active, __ATOMIC_SEQ_CST)];
+   __atomic_signal_fence(__ATOMIC_SEQ_CST);
+   n = buffer->nsamples;
+   ticks = buffer->nlost;
+   buffer->nsamples = 0;
+   buffer->nlost = 0;
+   if (n == 0 || node == 0) return 0;
+
+   while (__sync_lock_test_and_set(&table_lock, 1)) ;
+   for (i = 0; i < n; i++){
+      if (!buffer->pc[i] || add_entry(ithread, node, buffer->pc[i], buffer->weight[i]) != 0)
+         ticks += buffer->weight[i];
+   }
+   __sync_lock_release(&table_lock);
+   return ticks;
+#else
+   (void) ithread;
+   (void) node;
+   return 0;
+#endif
+}
+
+/* Resolves the samples recorded by cp_prof_collect into native frames and
+   returns their number. To be called by one thread while the others do not
+   sample, before cp_prof_get_frame. */
+int cp_prof_num_frames(void){
+#if defined(__linux__)
+   int status;
+
+   while (__sync_lock_test_and_set(&table_lock, 1)) ;
+   status = resolve_frames();
+   __sync_lock_release(&table_lock);
+   return status == 0 ? num_frames : 0;
+#else
+   return 0;
+#endif
+}
+
+/* Returns thread, node, samples and name of the i-th native frame, counted
+   from zero. The name is truncated to maxlen characters, its length is
+   returned, zero if the function is not known. */
+int cp_prof_get_frame(int i, int *ithread, int *node, int *samples, char *name, int maxlen){
+#if defined(__linux__)
+   int len;
+
+   if (i < 0 || i >= num_frames) return 0;
+   *ithread = frames[i].ithread;
+   *node = frames[i].node;
+   *samples = (int) frames[i].samples;
+   if (frames[i].name < 0) return 0;
+   len = (int) strlen(names[frames[i].name]);
+   if (len > maxlen) len = maxlen;
+   memcpy(name, names[frames[i].name], len);
+   return len;
+#else
+   (void) i; (void) ithread; (void) node; (void) samples; (void) name; (void) maxlen;
+   return 0;
+#endif
+}
+
+/* Stops the sampling timers of all threads and forgets the native frames,
+   to be called by one thread while the others do not sample. */
+void cp_prof_stop(void){
+#if defined(__linux__)
+   int i, n;
+
+   n = num_timers < MAX_TIMERS ? num_timers : MAX_TIMERS;
+   for (i = 0; i < n; i++) timer_delete(all_timers[i]);
+   num_timers = 0;
+   generation++;
+   prof_running = 0;
+
+   free_frames();
+   free(entries);
+   free(entry_hash);
+   entries = NULL;
+   entry_hash = NULL;
+   num_entries = max_entries = 0;
+   hash_size = 0;
+#endif
+}
@@ -257,6 +257,26 @@
   END SUBROUTINE cp_dbcsr_get_block_p_c
 
 
+! *****************************************************************************
+!> \brief Returns the local data area of the matrix, which holds all its
+!>        local blocks.
+!> \param matrix ...
+!> \param select_data_type selects the data type of the area
+!> \retval DATA ...
+! *****************************************************************************
+  FUNCTION cp_dbcsr_get_data_p_c (matrix, select_data_type) RESULT (DATA)
+    TYPE(cp_dbcsr_type), INTENT(IN)           :: matrix
+    COMPLEX(kind=real_4), INTENT(IN)                       :: select_data_type
+    COMPLEX(kind=real_4), DIMENSION(:), POINTER            :: DATA
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'cp_dbcsr_get_data_p_c', &
+      routineP = moduleN//':'//routineN
+
+    DATA => dbcsr_get_data_p(matrix%matrix%m%data_area, select_data_type)
+
+  END FUNCTION cp_dbcsr_get_data_p_c
+
+
 ! *****************************************************************************
 !> \brief ...
 !> \param matrix_a ...
@@ -257,6 +257,26 @@
   END SUBROUTINE cp_dbcsr_get_block_p_s
 
 
+! *****************************************************************************
+!> \brief Returns the local data area of the matrix, which holds all its
+!>        local blocks.
+!> \param matrix ...
+!> \param select_data_type selects the data type of the area
+!> \retval DATA ...
+! *****************************************************************************
+  FUNCTION cp_dbcsr_get_data_p_s (matrix, select_data_type) RESULT (DATA)
+    TYPE(cp_dbcsr_type), INTENT(IN)           :: matrix
+    REAL(kind=real_4), INTENT(IN)                       :: select_data_type
+    REAL(kind=real_4), DIMENSION(:), POINTER            :: DATA
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'cp_dbcsr_get_data_p_s', &
+      routineP = moduleN//':'//routineN
+
+    DATA => dbcsr_get_data_p(matrix%matrix%m%data_area, select_data_type)
+
+  END FUNCTION cp_dbcsr_get_data_p_s
+
+
 ! *****************************************************************************
 !> \brief ...
 !> \param matrix_a ...
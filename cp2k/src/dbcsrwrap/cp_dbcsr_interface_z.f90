@@ -257,6 +257,26 @@
   END SUBROUTINE cp_dbcsr_get_block_p_z
 
 
+! *****************************************************************************
+!> \brief Returns the local data area of the matrix, which holds all its
+!>        local blocks.
+!> \param matrix ...
+!> \param select_data_type selects the data type of the area
+!> \retval DATA ...
+! *****************************************************************************
+  FUNCTION cp_dbcsr_get_data_p_z (matrix, select_data_type) RESULT (DATA)
+    TYPE(cp_dbcsr_type), INTENT(IN)           :: matrix
+    COMPLEX(kind=real_8), INTENT(IN)                       :: select_data_type
+    COMPLEX(kind=real_8), DIMENSION(:), POINTER            :: DATA
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'cp_dbcsr_get_data_p_z', &
+      routineP = moduleN//':'//routineN
+
+    DATA => dbcsr_get_data_p(matrix%matrix%m%data_area, select_data_type)
+
+  END FUNCTION cp_dbcsr_get_data_p_z
+
+
 ! *****************************************************************************
 !> \brief ...
 !> \param matrix_a ...
@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <unistd.h>
 
 #define MAX_SIZE 8192
 #include "ma_components.h"
@@ -823,6 +824,260 @@ void hw_set_thread_cores(int distance, int core)
     hwloc_bitmap_free(set);
 }
 
+/*
+* Share of the cores of the current process for the automatic placement,
+* the cores are ordered by NUMA node
+*/
+static int *share_cores = NULL;
+static int nshare_cores = 0;
+
+/*
+* Get the cores the process may run on, cpus[i] is 1 if core i is allowed,
+* for the first ncpus cores.
+* return the number of entries needed for all allowed cores, -1 on failure
+*/
+int hw_get_allowed_cpus(int *cpus, int ncpus)
+{
+  hwloc_cpuset_t allowed;
+  int i, n;
+
+  allowed = hwloc_bitmap_alloc();
+  if(hwloc_get_cpubind(topology,allowed,HWLOC_CPUBIND_PROCESS)!=0){
+    hwloc_bitmap_free(allowed);
+    return -1;
+  }
+  n = hwloc_bitmap_last(allowed)+1;
+  for(i=0;i<ncpus;i++)
+     cpus[i] = hwloc_bitmap_isset(allowed,i) ? 1 : 0;
+  hwloc_bitmap_free(allowed);
+  return n;
+}
+
+/*
+* Compute the share of the local rank among the nlocal processes of the node.
+* The allowed cores are ordered by NUMA node and split in nlocal contiguous
+* chunks. With more processes than cores they share them round robin.
+* Returns the number of cores of the share.
+*/
+static int hw_compute_share(hwloc_const_cpuset_t allowed, int local_rank, int nlocal)
+{
+  hwloc_obj_t obj;
+  int *cores, *nodes;
+  int i, j, n, ncpus, node, first, last;
+
+  ncpus = hwloc_bitmap_weight(allowed);
+  if(ncpus < 1 || nlocal < 1 || local_rank < 0)
+     return -1;
+
+  cores = malloc(ncpus*sizeof(int));
+  nodes = malloc(ncpus*sizeof(int));
+  n = 0;
+  hwloc_bitmap_foreach_begin(i,allowed)
+    obj = hwloc_get_pu_obj_by_os_index(topology,i);
+    node = 0;
+    if(obj && obj->nodeset && !hwloc_bitmap_iszero(obj->nodeset))
+       node = hwloc_bitmap_first(obj->nodeset);
+    // insertion keeps the cores of a node in increasing order
+    for(j=n;j>0 && nodes[j-1]>node;j--){
+       cores[j] = cores[j-1];
+       nodes[j] = nodes[j-1];
+    }
+    cores[j] = i;
+    nodes[j] = node;
+    n++;
+  hwloc_bitmap_foreach_end();
+
+  if(nlocal <= n){
+    first = (local_rank*n)/nlocal;
+    last = ((local_rank+1)*n)/nlocal;
+  }
+  else{
+    first = local_rank%n;
+    last = first+1;
+  }
+
+  free(share_cores);
+  nshare_cores = last-first;
+  share_cores = malloc(nshare_cores*sizeof(int));
+  for(i=first;i<last;i++)
+     share_cores[i-first] = cores[i];
+
+  free(cores);
+  free(nodes);
+  return nshare_cores;
+}
+
+/*
+* Bind the current process to its share of the allowed cores of the node.
+* node_cpus[i] is 1 if core i is allowed to any process of the node (see
+* hw_get_allowed_cpus), so that a binding of the launcher does not leave
+* cores idle. Without it (ncpus 0), or if the process may not run on its
+* share of them (e.g. a cgroup per process), the cores allowed to the
+* process are split instead.
+* return the number of cores of the share, -1 on failure
+*/
+int hw_set_proc_share(int local_rank, int nlocal, const int *node_cpus,
+                      int ncpus)
+{
+  hwloc_cpuset_t allowed, set;
+  int i, pass, error;
+
+  allowed = hwloc_bitmap_alloc();
+  set = hwloc_bitmap_alloc();
+  error = -1;
+  for(pass=(ncpus>0 ? 0 : 1);pass<2 && error!=0;pass++){
+    hwloc_bitmap_zero(allowed);
+    if(pass==0){
+      for(i=0;i<ncpus;i++)
+         if(node_cpus[i]) hwloc_bitmap_set(allowed,i);
+    }
+    else if(hwloc_get_cpubind(topology,allowed,HWLOC_CPUBIND_PROCESS)!=0)
+       break;
+
+    if(hw_compute_share(allowed,local_rank,nlocal) < 1)
+       continue;
+    hwloc_bitmap_zero(set);
+    for(i=0;i<nshare_cores;i++)
+       hwloc_bitmap_set(set,share_cores[i]);
+    error = hwloc_set_cpubind(topology,set,HWLOC_CPUBIND_PROCESS);
+  }
+  hwloc_bitmap_free(allowed);
+  hwloc_bitmap_free(set);
+  if(error!=0)
+     return -1;
+  return nshare_cores;
+}
+
+/*
+* Take the cores of the current process as its share, unless it has one
+* already. To be called by one thread before the threads bind themselves
+* with hw_set_thread_share, which only reads the share.
+* return the number of cores of the share, -1 on failure
+*/
+int hw_init_thread_share(void)
+{
+  hwloc_cpuset_t allowed;
+  int ncores;
+
+  if(nshare_cores > 0)
+     return nshare_cores;
+  allowed = hwloc_bitmap_alloc();
+  ncores = -1;
+  if(hwloc_get_cpubind(topology,allowed,HWLOC_CPUBIND_PROCESS)==0)
+     ncores = hw_compute_share(allowed,0,1);
+  hwloc_bitmap_free(allowed);
+  return ncores;
+}
+
+/*
+* Bind the current thread to a compact part of the share of its process,
+* see hw_init_thread_share.
+* With more threads than cores the threads may run on the whole share.
+* return the first core of the thread, -1 on failure
+*/
+int hw_set_thread_share(int id, int nthreads)
+{
+  hwloc_cpuset_t set;
+  int i, first, last, error;
+
+  if(nshare_cores < 1 || nthreads < 1 || id < 0)
+     return -1;
+
+  if(nthreads <= nshare_cores){
+    first = (id*nshare_cores)/nthreads;
+    last = ((id+1)*nshare_cores)/nthreads;
+  }
+  else{
+    first = 0;
+    last = nshare_cores;
+  }
+
+  set = hwloc_bitmap_alloc();
+  hwloc_bitmap_zero(set);
+  for(i=first;i<last;i++)
+     hwloc_bitmap_set(set,share_cores[i]);
+  error = hwloc_set_cpubind(topology,set,HWLOC_CPUBIND_THREAD);
+  hwloc_bitmap_free(set);
+  if(error!=0)
+     return -1;
+  return share_cores[first];
+}
+
+/*
+* Get the first and last core and the number of cores of the share of the
+* current process, -1 if there is none
+*/
+void hw_get_proc_share(int *first, int *last, int *ncores)
+{
+  if(nshare_cores < 1){
+    *first = -1;
+    *last = -1;
+    *ncores = -1;
+  }
+  else{
+    *first = share_cores[0];
+    *last = share_cores[nshare_cores-1];
+    *ncores = nshare_cores;
+  }
+}
+
+/*
+* Count the pages of the memory area [addr+offset,addr+offset+nbytes) that are
+* on the NUMA node and on the other nodes. At most nsample pages evenly
+* spread over the area are queried, pages not touched yet are not counted.
+* hwloc_get_area_memlocation only tells the nodes of the whole area, so the
+* move_pages system call is used directly, as in linux_get_pages_node.
+* return 0 on success, -1 on failure
+*/
+int hw_get_pages_node(void *addr, size_t offset, size_t nbytes, int node,
+                      int nsample, int *nlocal, int *nremote)
+{
+#if defined(__linux__) && defined(SYS_move_pages)
+  void **pages;
+  int *status;
+  long page_size;
+  size_t first, last, npages, stride, i, n;
+  long error;
+
+  *nlocal = 0;
+  *nremote = 0;
+  if(nbytes == 0)
+     return 0;
+  if(addr == NULL || nsample < 1)
+     return -1;
+
+  page_size = sysconf(_SC_PAGESIZE);
+  first = ((size_t)addr+offset)/page_size;
+  last = ((size_t)addr+offset+nbytes-1)/page_size;
+  npages = last-first+1;
+  stride = (npages+nsample-1)/nsample;
+  n = (npages+stride-1)/stride;
+
+  pages = malloc(n*sizeof(void *));
+  status = malloc(n*sizeof(int));
+  for(i=0;i<n;i++)
+     pages[i] = (void *)((first+i*stride)*page_size);
+
+  // without target nodes move_pages only returns where the pages are
+  error = syscall(SYS_move_pages,0,(unsigned long)n,pages,NULL,status,0);
+  if(error == 0){
+    for(i=0;i<n;i++){
+      if(status[i] < 0) continue;
+      if(status[i] == node) (*nlocal)++;
+      else (*nremote)++;
+    }
+  }
+
+  free(pages);
+  free(status);
+  return (error == 0) ? 0 : -1;
+#else
+  *nlocal = 0;
+  *nremote = 0;
+  return -1;
+#endif
+}
+
 /*
 * Get the node where the current thread is running
 * return the node of the core
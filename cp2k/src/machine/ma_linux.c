@@ -16,6 +16,7 @@
 #include <numa.h>
 #include <numaif.h>
 #include <dirent.h>
+#include <unistd.h>
 
 #include "ma_linux.h"
 #include "ma_components.h"
@@ -471,6 +472,236 @@ void linux_set_proc_node(int node)
 
 }
 
+/*
+* Share of the cores of the current process for the automatic placement,
+* the cores are ordered by NUMA node
+*/
+static int *share_cores = NULL;
+static int nshare_cores = 0;
+
+/*
+* Get the cores the calling thread may run on, cpus[i] is 1 if core i is
+* allowed, for the first ncpus cores.
+* return the number of entries needed for all allowed cores, -1 on failure
+*/
+int linux_get_allowed_cpus(int *cpus, int ncpus)
+{
+  cpu_set_t allowed;
+  int i, n;
+
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0,sizeof(allowed),&allowed)!=0)
+     return -1;
+  n = 0;
+  for(i=0;i<CPU_SETSIZE;i++){
+    if(CPU_ISSET(i,&allowed)) n = i+1;
+    if(i<ncpus) cpus[i] = CPU_ISSET(i,&allowed) ? 1 : 0;
+  }
+  return n;
+}
+
+/*
+* Compute the share of the local rank among the nlocal processes of the node.
+* The allowed cores are ordered by NUMA node and split in nlocal contiguous
+* chunks. With more processes than cores they share them round robin.
+* Returns the number of cores of the share.
+*/
+static int linux_compute_share(cpu_set_t *allowed, int local_rank, int nlocal)
+{
+  int *cores, *nodes;
+  int i, j, n, ncpus, node, first, last;
+
+  ncpus = CPU_COUNT(allowed);
+  if(ncpus < 1 || nlocal < 1 || local_rank < 0)
+     return -1;
+
+  cores = malloc(ncpus*sizeof(int));
+  nodes = malloc(ncpus*sizeof(int));
+  n = 0;
+  for(i=0;i<CPU_SETSIZE && n<ncpus;i++){
+    if(!CPU_ISSET(i,allowed)) continue;
+    node = linux_get_nodeid_cpu(i);
+    // insertion keeps the cores of a node in increasing order
+    for(j=n;j>0 && nodes[j-1]>node;j--){
+       cores[j] = cores[j-1];
+       nodes[j] = nodes[j-1];
+    }
+    cores[j] = i;
+    nodes[j] = node;
+    n++;
+  }
+
+  if(nlocal <= n){
+    first = (local_rank*n)/nlocal;
+    last = ((local_rank+1)*n)/nlocal;
+  }
+  else{
+    first = local_rank%n;
+    last = first+1;
+  }
+
+  free(share_cores);
+  nshare_cores = last-first;
+  share_cores = malloc(nshare_cores*sizeof(int));
+  for(i=first;i<last;i++)
+     share_cores[i-first] = cores[i];
+
+  free(cores);
+  free(nodes);
+  return nshare_cores;
+}
+
+/*
+* Bind the current process to its share of the allowed cores of the node.
+* node_cpus[i] is 1 if core i is allowed to any process of the node (see
+* linux_get_allowed_cpus), so that a binding of the launcher does not leave
+* cores idle. Without it (ncpus 0), or if the process may not run on its
+* share of them (e.g. a cgroup per process), the cores allowed to the
+* process are split instead.
+* return the number of cores of the share, -1 on failure
+*/
+int linux_set_proc_share(int local_rank, int nlocal, const int *node_cpus,
+                         int ncpus)
+{
+  cpu_set_t allowed, set;
+  int i, pass;
+
+  for(pass=(ncpus>0 ? 0 : 1);pass<2;pass++){
+    CPU_ZERO(&allowed);
+    if(pass==0){
+      for(i=0;i<ncpus && i<CPU_SETSIZE;i++)
+         if(node_cpus[i]) CPU_SET(i,&allowed);
+    }
+    else if(sched_getaffinity(0,sizeof(allowed),&allowed)!=0)
+       return -1;
+
+    if(linux_compute_share(&allowed,local_rank,nlocal) < 1)
+       continue;
+    CPU_ZERO(&set);
+    for(i=0;i<nshare_cores;i++)
+       CPU_SET(share_cores[i],&set);
+    if(sched_setaffinity(0,sizeof(set),&set)==0)
+       return nshare_cores;
+  }
+  return -1;
+}
+
+/*
+* Take the cores the current process may run on as its share, unless it
+* has one already. To be called by one thread before the threads bind
+* themselves with linux_set_thread_share, which only reads the share.
+* return the number of cores of the share, -1 on failure
+*/
+int linux_init_thread_share(void)
+{
+  cpu_set_t allowed;
+
+  if(nshare_cores > 0)
+     return nshare_cores;
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0,sizeof(allowed),&allowed)!=0)
+     return -1;
+  return linux_compute_share(&allowed,0,1);
+}
+
+/*
+* Bind the current thread to a compact part of the share of its process,
+* see linux_init_thread_share.
+* With more threads than cores the threads may run on the whole share.
+* return the first core of the thread, -1 on failure
+*/
+int linux_set_thread_share(int id, int nthreads)
+{
+  cpu_set_t set;
+  int i, first, last;
+
+  if(nshare_cores < 1 || nthreads < 1 || id < 0)
+     return -1;
+
+  if(nthreads <= nshare_cores){
+    first = (id*nshare_cores)/nthreads;
+    last = ((id+1)*nshare_cores)/nthreads;
+  }
+  else{
+    first = 0;
+    last = nshare_cores;
+  }
+
+  CPU_ZERO(&set);
+  for(i=first;i<last;i++)
+     CPU_SET(share_cores[i],&set);
+  if(sched_setaffinity(syscall(SYS_gettid),sizeof(set),&set)!=0)
+     return -1;
+  return share_cores[first];
+}
+
+/*
+* Get the first and last core and the number of cores of the share of the
+* current process, -1 if there is none
+*/
+void linux_get_proc_share(int *first, int *last, int *ncores)
+{
+  if(nshare_cores < 1){
+    *first = -1;
+    *last = -1;
+    *ncores = -1;
+  }
+  else{
+    *first = share_cores[0];
+    *last = share_cores[nshare_cores-1];
+    *ncores = nshare_cores;
+  }
+}
+
+/*
+* Count the pages of the memory area [addr+offset,addr+offset+nbytes) that are
+* on the NUMA node and on the other nodes. At most nsample pages evenly
+* spread over the area are queried, pages not touched yet are not counted.
+* return 0 on success, -1 on failure
+*/
+int linux_get_pages_node(void *addr, size_t offset, size_t nbytes, int node,
+                         int nsample, int *nlocal, int *nremote)
+{
+  void **pages;
+  int *status;
+  long page_size;
+  size_t first, last, npages, stride, i, n;
+  int error;
+
+  *nlocal = 0;
+  *nremote = 0;
+  if(nbytes == 0)
+     return 0;
+  if(addr == NULL || nsample < 1)
+     return -1;
+
+  page_size = sysconf(_SC_PAGESIZE);
+  first = ((size_t)addr+offset)/page_size;
+  last = ((size_t)addr+offset+nbytes-1)/page_size;
+  npages = last-first+1;
+  stride = (npages+nsample-1)/nsample;
+  n = (npages+stride-1)/stride;
+
+  pages = malloc(n*sizeof(void *));
+  status = malloc(n*sizeof(int));
+  for(i=0;i<n;i++)
+     pages[i] = (void *)((first+i*stride)*page_size);
+
+  // without target nodes move_pages only returns where the pages are
+  error = move_pages(0,n,pages,NULL,status,0);
+  if(error == 0){
+    for(i=0;i<n;i++){
+      if(status[i] < 0) continue;
+      if(status[i] == node) (*nlocal)++;
+      else (*nremote)++;
+    }
+  }
+
+  free(pages);
+  free(status);
+  return (error == 0) ? 0 : -1;
+}
+
 /*
 * Set the memory policy for data allocation for a process
 */
@@ -72,7 +72,17 @@ void linux_set_my_core(int core);
 int linux_my_core();
 
 int linux_get_nodeid();
+int linux_get_nodeid_cpu(int cpu);
 void linux_set_mempol(int mempol, int node);
 
+int linux_get_allowed_cpus(int *cpus, int ncpus);
+int linux_set_proc_share(int local_rank, int nlocal, const int *node_cpus,
+                         int ncpus);
+int linux_init_thread_share(void);
+int linux_set_thread_share(int id, int nthreads);
+void linux_get_proc_share(int *first, int *last, int *ncores);
+int linux_get_pages_node(void *addr, size_t offset, size_t nbytes, int node,
+                         int nsample, int *nlocal, int *nremote);
+
 #endif
 #endif
@@ -49,7 +49,8 @@
          group,status(1),ierror)
     t_end = m_walltime ( )
     IF ( ierror /= 0 ) CALL mp_stop ( ierror, "mpi_sendrecv_replace @ "//routineN )
-    CALL add_perf(perf_id=7,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=7,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer=right,peer_bytes=msglen*int_8_size)
     DEALLOCATE(status)
 #endif
     CALL mp_timestop(handle)
@@ -107,7 +108,8 @@
          tag,group,status(1),ierror)
     t_end = m_walltime ( )
     IF ( ierror /= 0 ) CALL mp_stop ( ierror, "mpi_sendrecv_replace @ "//routineN )
-    CALL add_perf(perf_id=7,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=7,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer=right,peer_bytes=msglen*int_8_size)
     DEALLOCATE(status)
 #endif
     CALL mp_timestop(handle)
@@ -161,7 +163,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoallv @ "//routineN )
     t_end = m_walltime ( )
     msglen = SUM ( scount ) + SUM ( rcount )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_counts=scount,elem_size=int_8_size)
 #else
     !$OMP PARALLEL DO DEFAULT(NONE) PRIVATE(i) SHARED(rcount,rdispl,sdispl,rb,sb)
     DO i=1,rcount(1)
@@ -213,7 +216,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoallv @ "//routineN )
     msglen = SUM ( scount ) + SUM ( rcount )
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*2*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*2*int_8_size,&
+         gid=group,peer_counts=scount,elem_size=int_8_size)
 #else
     rb=sb
 #endif
@@ -221,6 +225,273 @@
 
   END SUBROUTINE mp_alltoall_l22v
 
+! *****************************************************************************
+!> \brief Non-blocking all-to-all data exchange, rank-1 data of different sizes
+!> \param sb              Data to send
+!> \param scount          Data counts for data sent to other processes
+!> \param sdispl          Respective data offsets for data sent to process
+!> \param rb              Buffer into which to receive data
+!> \param rcount          Data counts for data received from other processes
+!> \param rdispl          Respective data offsets for data received from
+!>                        other processes
+!> \param group           Message passing environment identifier
+!> \param request         Request handle, to be completed with mp_wait(all)
+!> \par MPI mapping
+!>      mpi_ialltoallv
+!> \note see mp_alltoall_l11v
+!> \note
+!>      The buffers must be pointers to be sure that we do not get
+!>      temporaries, and none of the arguments may be modified before
+!>      the request has been completed.
+!>      Without MPI-3 support (__MPI_VERSION < 3) the exchange is done
+!>      blocking and a null request is returned.
+! *****************************************************************************
+  SUBROUTINE mp_ialltoall_l11v ( sb, scount, sdispl, rb, rcount, rdispl, group, request )
+
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: sb
+    INTEGER, DIMENSION(:), INTENT(IN)        :: scount, sdispl
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: rb
+    INTEGER, DIMENSION(:), INTENT(IN)        :: rcount, rdispl
+    INTEGER, INTENT(IN)                      :: group
+    INTEGER, INTENT(OUT)                     :: request
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_ialltoall_l11v', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: handle, ierr
+#if defined(__parallel)
+    INTEGER                                  :: msglen
+#else
+    INTEGER                                  :: i
+#endif
+
+    CALL mp_timeset(routineN,handle)
+
+    ierr = 0
+#if defined(__parallel)
+    t_start = m_walltime ( )
+#if __MPI_VERSION > 2
+    CALL mpi_ialltoallv ( sb, scount, sdispl, MPI_INTEGER8, &
+         rb, rcount, rdispl, MPI_INTEGER8, group, request, ierr )
+    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_ialltoallv @ "//routineN )
+#else
+    CALL mpi_alltoallv ( sb, scount, sdispl, MPI_INTEGER8, &
+         rb, rcount, rdispl, MPI_INTEGER8, group, ierr )
+    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoallv @ "//routineN )
+    request = mp_request_null
+#endif
+    t_end = m_walltime ( )
+    msglen = SUM ( scount ) + SUM ( rcount )
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_counts=scount,elem_size=int_8_size)
+#else
+    DO i=1,rcount(1)
+       rb(rdispl(1)+i)=sb(sdispl(1)+i)
+    ENDDO
+    request = mp_request_null
+#endif
+    CALL mp_timestop(handle)
+
+  END SUBROUTINE mp_ialltoall_l11v
+
+! *****************************************************************************
+!> \brief Non-blocking all-to-all data exchange, rank-1 data of equal sizes
+!> \param sb              array with data to send
+!> \param rb              array into which data is received
+!> \param count           number of elements to send/receive (product of the
+!>                        extents of the first two dimensions)
+!> \param group           Message passing environment identifier
+!> \param request         Request handle, to be completed with mp_wait(all)
+!> \par MPI mapping
+!>      mpi_ialltoall
+!> \note see mp_ialltoall_l11v
+! *****************************************************************************
+  SUBROUTINE mp_ialltoall_l11 ( sb, rb, count, group, request )
+
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: sb, rb
+    INTEGER, INTENT(IN)                      :: count, group
+    INTEGER, INTENT(OUT)                     :: request
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_ialltoall_l11', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: handle, ierr
+#if defined(__parallel)
+    INTEGER                                  :: msglen, np
+#endif
+
+    CALL mp_timeset(routineN,handle)
+
+    ierr = 0
+#if defined(__parallel)
+    t_start = m_walltime ( )
+    CALL mpi_comm_size ( group, np, ierr )
+    IF ( ierr /= 0 ) CALL mp_stop ( ierr, "mpi_comm_size @ "//routineN )
+#if __MPI_VERSION > 2
+    CALL mpi_ialltoall ( sb, count, MPI_INTEGER8, &
+         rb, count, MPI_INTEGER8, group, request, ierr )
+    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_ialltoall @ "//routineN )
+#else
+    CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
+         rb, count, MPI_INTEGER8, group, ierr )
+    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
+    request = mp_request_null
+#endif
+    t_end = m_walltime ( )
+    msglen = 2 * count * np
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_each=count,elem_size=int_8_size)
+#else
+    rb(1:count) = sb(1:count)
+    request = mp_request_null
+#endif
+    CALL mp_timestop(handle)
+
+  END SUBROUTINE mp_ialltoall_l11
+
+! *****************************************************************************
+!> \brief Non-blocking element-wise sum of a rank-1 array on all processes.
+!> \param msg             Vector to sum and result
+!> \param gid             Message passing environment identifier
+!> \param request         Request handle, to be completed with mp_wait(all)
+!> \par MPI mapping
+!>      mpi_iallreduce
+!> \note see mp_ialltoall_l11v, the node-aware path of mp_sum is
+!>      not used
+! *****************************************************************************
+  SUBROUTINE mp_isum_lv(msg, gid, request)
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: msg
+    INTEGER, INTENT(IN)                      :: gid
+    INTEGER, INTENT(OUT)                     :: request
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_isum_lv', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: handle, ierr
+#if defined(__parallel)
+    INTEGER                                  :: msglen
+#endif
+
+    ierr = 0
+    CALL mp_timeset(routineN,handle)
+
+    request = mp_request_null
+#if defined(__parallel)
+    t_start = m_walltime ( )
+    msglen = SIZE(msg)
+    IF (msglen>0) THEN
+#if __MPI_VERSION > 2
+       CALL mpi_iallreduce(MPI_IN_PLACE,msg(LBOUND(msg,1)),msglen,MPI_INTEGER8,MPI_SUM,gid,request,ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_iallreduce @ "//routineN )
+#else
+       CALL mpi_allreduce(MPI_IN_PLACE,msg(LBOUND(msg,1)),msglen,MPI_INTEGER8,MPI_SUM,gid,ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allreduce @ "//routineN )
+#endif
+    END IF
+    t_end = m_walltime ( )
+    CALL add_perf(perf_id=3,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+#endif
+    CALL mp_timestop(handle)
+  END SUBROUTINE mp_isum_lv
+
+! *****************************************************************************
+!> \brief Non-blocking broadcast of rank-1 data to all processes
+!> \param msg             Data to broadcast
+!> \param source          Processor of the data
+!> \param gid             Message passing environment identifier
+!> \param request         Request handle, to be completed with mp_wait(all)
+!> \par MPI mapping
+!>      mpi_ibcast
+!> \note see mp_ialltoall_l11v
+! *****************************************************************************
+  SUBROUTINE mp_ibcast_lv(msg, source, gid, request)
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: msg
+    INTEGER, INTENT(IN)                      :: source, gid
+    INTEGER, INTENT(OUT)                     :: request
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_ibcast_lv', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: handle, ierr
+#if defined(__parallel)
+    INTEGER                                  :: msglen
+#endif
+
+    ierr = 0
+    CALL mp_timeset(routineN,handle)
+
+    request = mp_request_null
+#if defined(__parallel)
+    t_start = m_walltime ( )
+    msglen = SIZE(msg)
+    IF (msglen>0) THEN
+#if __MPI_VERSION > 2
+       CALL mpi_ibcast(msg(LBOUND(msg,1)),msglen,MPI_INTEGER8,source,gid,request,ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_ibcast @ "//routineN )
+#else
+       CALL mpi_bcast(msg(LBOUND(msg,1)),msglen,MPI_INTEGER8,source,gid,ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_bcast @ "//routineN )
+#endif
+    END IF
+    t_end = m_walltime ( )
+    CALL add_perf(perf_id=2,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+#endif
+    CALL mp_timestop(handle)
+  END SUBROUTINE mp_ibcast_lv
+
+! *****************************************************************************
+!> \brief Non-blocking gather of rank-1 data from all processes, all
+!>        processes receive the same data
+!> \param msgout          Rank-1 data to send
+!> \param msgin           Received data, the data of process i (counted
+!>                        from zero) starts at i*SIZE(msgout)+1
+!> \param gid             Message passing environment identifier
+!> \param request         Request handle, to be completed with mp_wait(all)
+!> \par Data size
+!>      All processes send equal-sized data
+!> \par MPI mapping
+!>      mpi_iallgather
+!> \note see mp_ialltoall_l11v
+! *****************************************************************************
+  SUBROUTINE mp_iallgather_l11(msgout, msgin, gid, request)
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: msgout, msgin
+    INTEGER, INTENT(IN)                      :: gid
+    INTEGER, INTENT(OUT)                     :: request
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_iallgather_l11', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: handle, ierr
+#if defined(__parallel)
+    INTEGER                                  :: scount
+#endif
+
+    ierr = 0
+    CALL mp_timeset(routineN,handle)
+
+    request = mp_request_null
+#if defined(__parallel)
+    t_start = m_walltime ( )
+    scount = SIZE(msgout)
+    IF (scount>0) THEN
+#if __MPI_VERSION > 2
+       CALL mpi_iallgather(msgout(LBOUND(msgout,1)), scount, MPI_INTEGER8, &
+                           msgin(LBOUND(msgin,1)), scount, MPI_INTEGER8, gid, request, ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_iallgather @ "//routineN )
+#else
+       CALL mpi_allgather(msgout(LBOUND(msgout,1)), scount, MPI_INTEGER8, &
+                          msgin(LBOUND(msgin,1)), scount, MPI_INTEGER8, gid, ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allgather @ "//routineN )
+#endif
+    END IF
+    t_end = m_walltime ( )
+    CALL add_perf(perf_id=4,count=1,time=t_end-t_start,msg_size=scount*int_8_size)
+#else
+    msgin(LBOUND(msgin,1):LBOUND(msgin,1)+SIZE(msgout)-1) = msgout(:)
+#endif
+    CALL mp_timestop(handle)
+  END SUBROUTINE mp_iallgather_l11
+
 ! *****************************************************************************
 !> \brief All-to-all data exchange, rank 1 arrays, equal sizes
 !> \param[in] sb    array with data to send
@@ -247,7 +518,7 @@
 
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
-    INTEGER                                  :: msglen, np
+    INTEGER                                  :: inode, msglen, np
 #endif
 
     ierr = 0
@@ -255,14 +526,20 @@
 
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
-         rb, count, MPI_INTEGER8, group, ierr )
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
     CALL mpi_comm_size ( group, np, ierr )
     IF ( ierr /= 0 ) CALL mp_stop ( ierr, "mpi_comm_size @ "//routineN )
+    inode = node_coll_entry(group, 2*INT(count, int_8)*np*int_8_size, INT(count, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_alltoall_l(sb, rb, count, inode)
+    ELSE
+       CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
+            rb, count, MPI_INTEGER8, group, ierr )
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
+    END IF
     msglen = 2 * count * np
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_each=count,elem_size=int_8_size)
 #else
     rb=sb
 #endif
@@ -289,7 +566,7 @@
 
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
-    INTEGER                                  :: msglen, np
+    INTEGER                                  :: inode, msglen, np
 #endif
 
     ierr = 0
@@ -297,14 +574,20 @@
 
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
-         rb, count, MPI_INTEGER8, group, ierr )
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
     CALL mpi_comm_size ( group, np, ierr )
     IF ( ierr /= 0 ) CALL mp_stop ( ierr, "mpi_comm_size @ "//routineN )
+    inode = node_coll_entry(group, 2*INT(count, int_8)*np*int_8_size, INT(count, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_alltoall_l(sb, rb, count, inode)
+    ELSE
+       CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
+            rb, count, MPI_INTEGER8, group, ierr )
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
+    END IF
     msglen = 2 * SIZE(sb) * np
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_each=count,elem_size=int_8_size)
 #else
     rb=sb
 #endif
@@ -331,7 +614,7 @@
 
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
-    INTEGER                                  :: msglen, np
+    INTEGER                                  :: inode, msglen, np
 #endif
 
     ierr = 0
@@ -339,14 +622,20 @@
 
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
-         rb, count, MPI_INTEGER8, group, ierr )
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
     CALL mpi_comm_size ( group, np, ierr )
     IF ( ierr /= 0 ) CALL mp_stop ( ierr, "mpi_comm_size @ "//routineN )
+    inode = node_coll_entry(group, 2*INT(count, int_8)*np*int_8_size, INT(count, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_alltoall_l(sb, rb, count, inode)
+    ELSE
+       CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
+            rb, count, MPI_INTEGER8, group, ierr )
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
+    END IF
     msglen = 2 * count * np
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_each=count,elem_size=int_8_size)
 #else
     rb=sb
 #endif
@@ -375,7 +664,7 @@
 
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
-    INTEGER                                  :: msglen, np
+    INTEGER                                  :: inode, msglen, np
 #endif
 
     ierr = 0
@@ -383,14 +672,20 @@
 
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
-         rb, count, MPI_INTEGER8, group, ierr )
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
     CALL mpi_comm_size ( group, np, ierr )
     IF ( ierr /= 0 ) CALL mp_stop ( ierr, "mpi_comm_size @ "//routineN )
+    inode = node_coll_entry(group, 2*INT(count, int_8)*np*int_8_size, INT(count, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_alltoall_l(sb, rb, count, inode)
+    ELSE
+       CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
+            rb, count, MPI_INTEGER8, group, ierr )
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
+    END IF
     msglen = 2 * count * np
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_each=count,elem_size=int_8_size)
 #else
     rb=sb
 #endif
@@ -420,7 +715,7 @@
 
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
-    INTEGER                                  :: msglen, np
+    INTEGER                                  :: inode, msglen, np
 #endif
 
     ierr = 0
@@ -428,14 +723,20 @@
 
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
-         rb, count, MPI_INTEGER8, group, ierr )
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
     CALL mpi_comm_size ( group, np, ierr )
     IF ( ierr /= 0 ) CALL mp_stop ( ierr, "mpi_comm_size @ "//routineN )
+    inode = node_coll_entry(group, 2*INT(count, int_8)*np*int_8_size, INT(count, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_alltoall_l(sb, rb, count, inode)
+    ELSE
+       CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
+            rb, count, MPI_INTEGER8, group, ierr )
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
+    END IF
     msglen = 2 * count * np
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_each=count,elem_size=int_8_size)
 #endif
     CALL mp_timestop(handle)
 
@@ -463,7 +764,7 @@
 
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
-    INTEGER                                  :: msglen, np
+    INTEGER                                  :: inode, msglen, np
 #endif
 
     ierr = 0
@@ -471,14 +772,20 @@
 
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
-         rb, count, MPI_INTEGER8, group, ierr )
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
     CALL mpi_comm_size ( group, np, ierr )
     IF ( ierr /= 0 ) CALL mp_stop ( ierr, "mpi_comm_size @ "//routineN )
+    inode = node_coll_entry(group, 2*INT(count, int_8)*np*int_8_size, INT(count, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_alltoall_l(sb, rb, count, inode)
+    ELSE
+       CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
+            rb, count, MPI_INTEGER8, group, ierr )
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
+    END IF
     msglen = 2 * count * np
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_each=count,elem_size=int_8_size)
 #endif
     CALL mp_timestop(handle)
 
@@ -506,7 +813,7 @@
 
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
-    INTEGER                                  :: msglen, np
+    INTEGER                                  :: inode, msglen, np
 #endif
 
     ierr = 0
@@ -514,14 +821,20 @@
 
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
-         rb, count, MPI_INTEGER8, group, ierr )
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
     CALL mpi_comm_size ( group, np, ierr )
     IF ( ierr /= 0 ) CALL mp_stop ( ierr, "mpi_comm_size @ "//routineN )
+    inode = node_coll_entry(group, 2*INT(count, int_8)*np*int_8_size, INT(count, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_alltoall_l(sb, rb, count, inode)
+    ELSE
+       CALL mpi_alltoall ( sb, count, MPI_INTEGER8, &
+            rb, count, MPI_INTEGER8, group, ierr )
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoall @ "//routineN )
+    END IF
     msglen = 2 * count * np
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=6,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=group,peer_each=count,elem_size=int_8_size)
 #endif
     CALL mp_timestop(handle)
 
@@ -554,7 +867,8 @@
     CALL mpi_send(msg,msglen,MPI_INTEGER8,dest,tag,gid,ierr)
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_send @ "//routineN )
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=13,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=13,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=gid,peer=dest)
 #endif
     CALL mp_timestop(handle)
   END SUBROUTINE mp_send_l
@@ -585,7 +899,8 @@
     CALL mpi_send(msg,msglen,MPI_INTEGER8,dest,tag,gid,ierr)
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_send @ "//routineN )
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=13,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=13,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=gid,peer=dest)
 #endif
     CALL mp_timestop(handle)
   END SUBROUTINE mp_send_lv
@@ -622,7 +937,8 @@
     CALL mpi_recv(msg,msglen,MPI_INTEGER8,source,tag,gid,status,ierr)
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_recv @ "//routineN )
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=14,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=14,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=gid,peer=status(MPI_SOURCE),peer_bytes=0)
     source = status(MPI_SOURCE)
     tag = status(MPI_TAG)
     DEALLOCATE(status)
@@ -661,7 +977,8 @@
     CALL mpi_recv(msg,msglen,MPI_INTEGER8,source,tag,gid,status,ierr)
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_recv @ "//routineN )
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=14,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=14,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=gid,peer=status(MPI_SOURCE),peer_bytes=0)
     source = status(MPI_SOURCE)
     tag = status(MPI_TAG)
     DEALLOCATE(status)
@@ -715,6 +1032,9 @@
       routineP = moduleN//':'//routineN
 
     INTEGER                                  :: handle, ierr, msglen
+#if defined(__parallel)
+    INTEGER                                  :: inode
+#endif
 
     ierr = 0
     CALL mp_timeset(routineN,handle)
@@ -722,8 +1042,13 @@
     msglen = SIZE(msg)
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_bcast(msg,msglen,MPI_INTEGER8,source,gid,ierr)
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_bcast @ "//routineN )
+    inode = node_coll_entry(gid, INT(msglen, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_bcast_l(msg, msglen, source, inode)
+    ELSE
+       CALL mpi_bcast(msg,msglen,MPI_INTEGER8,source,gid,ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_bcast @ "//routineN )
+    END IF
     t_end = m_walltime ( )
     CALL add_perf(perf_id=2,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
 #endif
@@ -745,6 +1070,9 @@
       routineP = moduleN//':'//routineN
 
     INTEGER                                  :: handle, ierr, msglen
+#if defined(__parallel)
+    INTEGER                                  :: inode
+#endif
 
     ierr = 0
     CALL mp_timeset(routineN,handle)
@@ -752,8 +1080,13 @@
     msglen = SIZE(msg)
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_bcast(msg,msglen,MPI_INTEGER8,source,gid,ierr)
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_bcast @ "//routineN )
+    inode = node_coll_entry(gid, INT(msglen, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_bcast_l(msg, msglen, source, inode)
+    ELSE
+       CALL mpi_bcast(msg,msglen,MPI_INTEGER8,source,gid,ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_bcast @ "//routineN )
+    END IF
     t_end = m_walltime ( )
     CALL add_perf(perf_id=2,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
 #endif
@@ -775,6 +1108,9 @@
       routineP = moduleN//':'//routineN
 
     INTEGER                                  :: handle, ierr, msglen
+#if defined(__parallel)
+    INTEGER                                  :: inode
+#endif
 
     ierr = 0
     CALL mp_timeset(routineN,handle)
@@ -782,8 +1118,13 @@
     msglen = SIZE(msg)
 #if defined(__parallel)
     t_start = m_walltime ( )
-    CALL mpi_bcast(msg,msglen,MPI_INTEGER8,source,gid,ierr)
-    IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_bcast @ "//routineN )
+    inode = node_coll_entry(gid, INT(msglen, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_bcast_l(msg, msglen, source, inode)
+    ELSE
+       CALL mpi_bcast(msg,msglen,MPI_INTEGER8,source,gid,ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_bcast @ "//routineN )
+    END IF
     t_end = m_walltime ( )
     CALL add_perf(perf_id=2,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
 #endif
@@ -835,7 +1176,7 @@
 
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
-    INTEGER                                  :: msglen
+    INTEGER                                  :: inode, msglen
 #endif
 
     ierr = 0
@@ -844,7 +1185,10 @@
 #if defined(__parallel)
     t_start = m_walltime ( )
     msglen = SIZE(msg)
-    IF (msglen>0) THEN
+    inode = node_coll_entry(gid, INT(msglen, int_8)*int_8_size)
+    IF (inode > 0) THEN
+       CALL mp_node_sum_l(msg, msglen, inode)
+    ELSE IF (msglen>0) THEN
     CALL mpi_allreduce(MPI_IN_PLACE,msg,msglen,MPI_INTEGER8,MPI_SUM,gid,ierr)
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allreduce @ "//routineN )
     END IF
@@ -870,7 +1214,7 @@
     INTEGER                                  :: handle, ierr
 #if defined(__parallel)
     INTEGER, PARAMETER :: max_msg=2**25
-    INTEGER                                  :: m1, msglen, step
+    INTEGER                                  :: inode, m1, msglen, step
 #endif
 
     ierr = 0
@@ -878,6 +1222,15 @@
 
 #if defined(__parallel)
     t_start = m_walltime ( )
+    inode = node_coll_entry(gid, INT(SIZE(msg), int_8)*int_8_size)
+    IF (inode > 0) THEN
+       msglen = SIZE(msg)
+       CALL mp_node_sum_l(msg, msglen, inode)
+       t_end = m_walltime ( )
+       CALL add_perf(perf_id=3,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+       CALL mp_timestop(handle)
+       RETURN
+    END IF
     ! chunk up the call so that message sizes are limited, to avoid overflows in mpich triggered in large rpa calcs
     step=MAX(1,SIZE(msg,2)/MAX(1,SIZE(msg)/max_msg))
     DO m1=LBOUND(msg,2),UBOUND(msg,2), step
@@ -908,13 +1261,19 @@
 
     INTEGER                                  :: handle, ierr, &
                                                 msglen
+#if defined(__parallel)
+    INTEGER                                  :: inode
+#endif
     ierr = 0
     CALL mp_timeset(routineN,handle)
 
     msglen = SIZE(msg)
 #if defined(__parallel)
     t_start = m_walltime ( )
-    IF (msglen>0) THEN
+    inode = node_coll_entry(gid, INT(msglen, int_8)*int_8_size)
+    IF (inode > 0) THEN
+      CALL mp_node_sum_l(msg, msglen, inode)
+    ELSE IF (msglen>0) THEN
       CALL mpi_allreduce(MPI_IN_PLACE,msg,msglen,MPI_INTEGER8,MPI_SUM,gid,ierr)
       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allreduce @ "//routineN )
     END IF
@@ -939,6 +1298,9 @@
 
     INTEGER                                  :: handle, ierr, &
                                                 msglen
+#if defined(__parallel)
+    INTEGER                                  :: inode
+#endif
 
     ierr = 0
     CALL mp_timeset(routineN,handle)
@@ -946,7 +1308,10 @@
     msglen = SIZE(msg)
 #if defined(__parallel)
     t_start = m_walltime ( )
-    IF (msglen>0) THEN
+    inode = node_coll_entry(gid, INT(msglen, int_8)*int_8_size)
+    IF (inode > 0) THEN
+      CALL mp_node_sum_l(msg, msglen, inode)
+    ELSE IF (msglen>0) THEN
       CALL mpi_allreduce(MPI_IN_PLACE,msg,msglen,MPI_INTEGER8,MPI_SUM,gid,ierr)
       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allreduce @ "//routineN )
     END IF
@@ -971,6 +1336,9 @@
 
     INTEGER                                  :: handle, ierr, &
                                                 msglen
+#if defined(__parallel)
+    INTEGER                                  :: inode
+#endif
 
     ierr = 0
     CALL mp_timeset(routineN,handle)
@@ -978,7 +1346,10 @@
     msglen = SIZE(msg)
 #if defined(__parallel)
     t_start = m_walltime ( )
-    IF (msglen>0) THEN
+    inode = node_coll_entry(gid, INT(msglen, int_8)*int_8_size)
+    IF (inode > 0) THEN
+      CALL mp_node_sum_l(msg, msglen, inode)
+    ELSE IF (msglen>0) THEN
       CALL mpi_allreduce(MPI_IN_PLACE,msg,msglen,MPI_INTEGER8,MPI_SUM,gid,ierr)
       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allreduce @ "//routineN )
     END IF
@@ -1003,6 +1374,9 @@
 
     INTEGER                                  :: handle, ierr, &
                                                 msglen
+#if defined(__parallel)
+    INTEGER                                  :: inode
+#endif
 
     ierr = 0
     CALL mp_timeset(routineN,handle)
@@ -1010,7 +1384,10 @@
     msglen = SIZE(msg)
 #if defined(__parallel)
     t_start = m_walltime ( )
-    IF (msglen>0) THEN
+    inode = node_coll_entry(gid, INT(msglen, int_8)*int_8_size)
+    IF (inode > 0) THEN
+      CALL mp_node_sum_l(msg, msglen, inode)
+    ELSE IF (msglen>0) THEN
       CALL mpi_allreduce(MPI_IN_PLACE,msg,msglen,MPI_INTEGER8,MPI_SUM,gid,ierr)
       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allreduce @ "//routineN )
     END IF
@@ -1020,6 +1397,174 @@
     CALL mp_timestop(handle)
   END SUBROUTINE mp_sum_lm6
 
+#if defined(__parallel)
+! *****************************************************************************
+!> \brief Returns the shared memory window of the node of an entry of
+!>        node_comms, with a segment of seg_elems elements for every rank.
+!> \param inode ...
+!> \param seg_elems ...
+!> \retval shm all segments, contiguous
+! *****************************************************************************
+  FUNCTION mp_node_window_l(inode, seg_elems) RESULT(shm)
+    INTEGER, INTENT(IN)                      :: inode, seg_elems
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: shm
+
+    TYPE(C_PTR)                              :: base
+
+    base = node_comm_window(inode, INT(seg_elems, int_8)*int_8_size)
+    CALL C_F_POINTER(base, shm, (/node_comms(inode)%node_size*seg_elems/))
+  END FUNCTION mp_node_window_l
+
+! *****************************************************************************
+!> \brief Node-aware sum: the ranks of a node copy their data into the shared
+!>        window and reduce it in parallel, the node leaders sum the node
+!>        results and everybody copies the result back.
+!>        Large messages are processed in chunks of one segment.
+!> \param msg data to sum and result
+!> \param msglen number of elements of msg
+!> \param inode entry of the communicator in node_comms
+! *****************************************************************************
+  SUBROUTINE mp_node_sum_l(msg, msglen, inode)
+    INTEGER(KIND=int_8), INTENT(INOUT)                   :: msg(*)
+    INTEGER, INTENT(IN)                      :: msglen, inode
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_node_sum_l', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: chunk, first, hi, i, ierr, &
+                                                lo, m, me, nlocal
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: shm
+
+    nlocal = node_comms(inode)%node_size
+    me = node_comms(inode)%node_rank
+    chunk = MAX(1, MIN(msglen, node_segment_bytes/int_8_size))
+    shm => mp_node_window_l(inode, chunk)
+
+    DO first = 1, msglen, chunk
+       m = MIN(chunk, msglen-first+1)
+       shm(me*chunk+1:me*chunk+m) = msg(first:first+m-1)
+       CALL node_comm_sync(inode)
+       ! every rank sums its part of the chunk into the segment of the first rank
+       lo = (me*m)/nlocal + 1
+       hi = ((me+1)*m)/nlocal
+       DO i = 1, nlocal-1
+          shm(lo:hi) = shm(lo:hi) + shm(i*chunk+lo:i*chunk+hi)
+       END DO
+       CALL node_comm_sync(inode)
+       IF (me == 0) THEN
+          CALL mpi_allreduce(MPI_IN_PLACE, shm, m, MPI_INTEGER8, MPI_SUM, &
+                             node_comms(inode)%leader_comm, ierr)
+          IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allreduce @ "//routineN )
+       END IF
+       CALL node_comm_sync(inode)
+       msg(first:first+m-1) = shm(1:m)
+       ! nobody may overwrite the window before all have read the result
+       CALL node_comm_sync(inode)
+    END DO
+  END SUBROUTINE mp_node_sum_l
+
+! *****************************************************************************
+!> \brief Node-aware broadcast: the source copies its data into the shared
+!>        window of its node, the node leaders broadcast the window, and
+!>        everybody copies the data out of the window of its node.
+!> \param msg data to broadcast
+!> \param msglen number of elements of msg
+!> \param source rank of the source in the communicator
+!> \param inode entry of the communicator in node_comms
+! *****************************************************************************
+  SUBROUTINE mp_node_bcast_l(msg, msglen, source, inode)
+    INTEGER(KIND=int_8)                                  :: msg(*)
+    INTEGER, INTENT(IN)                      :: msglen, source, inode
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_node_bcast_l', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: chunk, first, ierr, m, &
+                                                nlocal
+    LOGICAL                                  :: is_source
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: shm
+
+    nlocal = node_comms(inode)%node_size
+    is_source = (node_comms(inode)%rank == source)
+    ! the same on all nodes, the window of a node is shared by its ranks
+    chunk = MAX(1, MIN(msglen, node_segment_bytes/int_8_size))
+    shm => mp_node_window_l(inode, (chunk+nlocal-1)/nlocal)
+
+    DO first = 1, msglen, chunk
+       m = MIN(chunk, msglen-first+1)
+       IF (is_source) shm(1:m) = msg(first:first+m-1)
+       CALL node_comm_sync(inode)
+       IF (node_comms(inode)%node_rank == 0) THEN
+          CALL mpi_bcast(shm, m, MPI_INTEGER8, node_comms(inode)%node_of(source), &
+                         node_comms(inode)%leader_comm, ierr)
+          IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_bcast @ "//routineN )
+       END IF
+       CALL node_comm_sync(inode)
+       IF (.NOT. is_source) msg(first:first+m-1) = shm(1:m)
+       CALL node_comm_sync(inode)
+    END DO
+  END SUBROUTINE mp_node_bcast_l
+
+! *****************************************************************************
+!> \brief Node-aware all-to-all with blocks of count elements: the ranks of a
+!>        node sort their blocks by destination node into the shared window,
+!>        the node leaders exchange one message per pair of nodes, and every
+!>        rank picks its blocks from the window. This replaces the many
+!>        small messages between the ranks of two nodes by a single one.
+!> \param sb send buffer, one block per rank
+!> \param rb receive buffer, one block per rank
+!> \param count number of elements of a block
+!> \param inode entry of the communicator in node_comms
+! *****************************************************************************
+  SUBROUTINE mp_node_alltoall_l(sb, rb, count, inode)
+    INTEGER(KIND=int_8), INTENT(IN)                      :: sb(*)
+    INTEGER(KIND=int_8), INTENT(OUT)                     :: rb(*)
+    INTEGER, INTENT(IN)                      :: count, inode
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_node_alltoall_l', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: ierr, ipe, k, me, n, &
+                                                nlocal, pos
+    INTEGER, ALLOCATABLE, DIMENSION(:)       :: counts, displs
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: shm
+    TYPE(mp_node_comm_type), POINTER         :: node
+
+    node => node_comms(inode)
+    nlocal = node%node_size
+    me = node%node_rank
+    ! the blocks sent by this node, followed by the blocks it receives.
+    ! Both are ordered by remote node, then sending rank, then receiving rank.
+    n = nlocal*node%nprocs*count
+    shm => mp_node_window_l(inode, 2*node%nprocs*count)
+
+    DO ipe = 0, node%nprocs-1
+       k = node%node_of(ipe)
+       pos = (nlocal*node%ranks_before(k) + me*node%node_sizes(k) + node%local_of(ipe))*count
+       shm(pos+1:pos+count) = sb(ipe*count+1:(ipe+1)*count)
+    END DO
+    CALL node_comm_sync(inode)
+
+    IF (me == 0) THEN
+       ALLOCATE(counts(0:node%num_nodes-1), displs(0:node%num_nodes-1))
+       counts(:) = nlocal*node%node_sizes(:)*count
+       displs(:) = nlocal*node%ranks_before(:)*count
+       CALL mpi_alltoallv(shm, counts, displs, MPI_INTEGER8, &
+                          shm(n+1:2*n), counts, displs, MPI_INTEGER8, node%leader_comm, ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_alltoallv @ "//routineN )
+       DEALLOCATE(counts, displs)
+    END IF
+    CALL node_comm_sync(inode)
+
+    DO ipe = 0, node%nprocs-1
+       k = node%node_of(ipe)
+       pos = n + (nlocal*node%ranks_before(k) + node%local_of(ipe)*nlocal + me)*count
+       rb(ipe*count+1:(ipe+1)*count) = shm(pos+1:pos+count)
+    END DO
+    CALL node_comm_sync(inode)
+  END SUBROUTINE mp_node_alltoall_l
+#endif
+
 ! *****************************************************************************
 !> \brief Element-wise sum of data from all processes with result left only on
 !>        one.
@@ -1723,7 +2268,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_sendrecv @ "//routineN )
     t_end = m_walltime ( )
     CALL add_perf(perf_id=7,count=1,time=t_end-t_start,&
-         msg_size=(msglen_in+msglen_out)*int_8_size/2)
+         msg_size=(msglen_in+msglen_out)*int_8_size/2,&
+         gid=comm,peer=dest,peer_bytes=msglen_in*int_8_size)
     DEALLOCATE(status)
 #else
     msgout = msgin
@@ -1772,7 +2318,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_sendrecv @ "//routineN )
     t_end = m_walltime ( )
     CALL add_perf(perf_id=7,count=1,time=t_end-t_start,&
-         msg_size=(msglen_in+msglen_out)*int_8_size/2)
+         msg_size=(msglen_in+msglen_out)*int_8_size/2,&
+         gid=comm,peer=dest,peer_bytes=msglen_in*int_8_size)
     DEALLOCATE(status)
 #else
     msgout = msgin
@@ -1821,7 +2368,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_sendrecv @ "//routineN )
     t_end = m_walltime ( )
     CALL add_perf(perf_id=7,count=1,time=t_end-t_start,&
-         msg_size=(msglen_in+msglen_out)*int_8_size/2)
+         msg_size=(msglen_in+msglen_out)*int_8_size/2,&
+         gid=comm,peer=dest,peer_bytes=msglen_in*int_8_size)
     DEALLOCATE(status)
 #else
     msgout = msgin
@@ -1897,7 +2445,8 @@
 
     msglen = (msglen+SIZE(msgout,1)+1)/2
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=8,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=8,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=comm,peer=dest,peer_bytes=SIZE(msgin)*int_8_size)
 #else
     send_request=0
     recv_request=0
@@ -1975,7 +2524,8 @@
 
     msglen = (msglen+SIZE(msgout,1)*SIZE(msgout,2)+1)/2
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=8,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=8,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=comm,peer=dest,peer_bytes=SIZE(msgin)*int_8_size)
 #else
     send_request=0
     recv_request=0
@@ -2033,7 +2583,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_isend @ "//routineN )
 
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=11,count=1,time=t_end-t_start,msg_size=2*msglen*int_8_size)
+    CALL add_perf(perf_id=11,count=1,time=t_end-t_start,msg_size=2*msglen*int_8_size,&
+         gid=comm,peer=dest,peer_bytes=msglen*int_8_size)
 #else
     ierr=1
     CALL mp_stop( ierr, "mp_isend called in non parallel case" )
@@ -2093,7 +2644,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_isend @ "//routineN )
 
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=11,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=11,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=comm,peer=dest,peer_bytes=msglen*int_8_size)
 #else
     ierr=1
     CALL mp_stop( ierr, "mp_isend called in non parallel case" )
@@ -2158,7 +2710,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_isend @ "//routineN )
 
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=11,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=11,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=comm,peer=dest,peer_bytes=msglen*int_8_size)
 #else
     ierr=1
     CALL mp_stop( ierr, "mp_isend called in non parallel case" )
@@ -2216,7 +2769,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_irecv @ "//routineN )
 
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=12,count=1,time=t_end-t_start,msg_size=2*msglen*int_8_size)
+    CALL add_perf(perf_id=12,count=1,time=t_end-t_start,msg_size=2*msglen*int_8_size,&
+         gid=comm,peer=source,peer_bytes=0)
 #else
     CALL mp_abort( "mp_irecv called in non parallel case" )
 #endif
@@ -2275,7 +2829,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_irecv @ "//routineN )
 
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=12,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=12,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=comm,peer=source,peer_bytes=0)
 #else
     CALL mp_abort( "mp_irecv called in non parallel case" )
 #endif
@@ -2339,7 +2894,8 @@
     IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_ircv @ "//routineN )
 
     t_end = m_walltime ( )
-    CALL add_perf(perf_id=12,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+    CALL add_perf(perf_id=12,count=1,time=t_end-t_start,msg_size=msglen*int_8_size,&
+         gid=comm,peer=source,peer_bytes=0)
 #else
     CALL mp_abort( "mp_irecv called in non parallel case" )
 #endif
@@ -2799,3 +3355,103 @@
      ENDIF
 #endif
    END SUBROUTINE mp_free_mem_l
+
+! *****************************************************************************
+!> \brief Allocates an array that is replicated on all ranks of gid. The ranks
+!>        of a node share a single copy in a shared memory window if MPI-3
+!>        is available, otherwise every rank allocates its own.
+!> \param shm            handle of the array, needed to free and synchronize it
+!> \param DATA           the array
+!> \param n              number of elements
+!> \param gid            communicator holding the replicas, has to be kept
+!>                       until the array is freed
+!> \note
+!>      collective on gid. A shared array is written by all ranks of the node
+!>      alike, so writes of different ranks must not overlap and have to be
+!>      followed by mp_shm_sync before the others read them.
+! *****************************************************************************
+  SUBROUTINE mp_shm_allocate_lv(shm, DATA, n, gid)
+    TYPE(mp_shm_type), INTENT(OUT)           :: shm
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: DATA
+    INTEGER, INTENT(IN)                      :: n, gid
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_shm_allocate_lv', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: handle
+    TYPE(C_PTR)                              :: base
+
+    CALL mp_timeset(routineN,handle)
+
+    base = mp_shm_create(shm, INT(n, int_8)*int_8_size, gid)
+    IF (shm%shared) THEN
+       CALL C_F_POINTER(base, DATA, (/n/))
+    ELSE
+       ALLOCATE(DATA(n))
+    END IF
+
+    CALL mp_timestop(handle)
+  END SUBROUTINE mp_shm_allocate_lv
+
+! *****************************************************************************
+!> \brief Frees an array allocated by mp_shm_allocate.
+!> \param shm ...
+!> \param DATA ...
+!> \note
+!>      collective on gid
+! *****************************************************************************
+  SUBROUTINE mp_shm_free_lv(shm, DATA)
+    TYPE(mp_shm_type), INTENT(INOUT)         :: shm
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: DATA
+
+    IF (shm%shared) THEN
+       NULLIFY(DATA)
+    ELSE
+       DEALLOCATE(DATA)
+    END IF
+    CALL mp_shm_release(shm)
+  END SUBROUTINE mp_shm_free_lv
+
+! *****************************************************************************
+!> \brief Sums the contributions of all ranks of gid to an array allocated by
+!>        mp_shm_allocate. A shared array holds the contributions of all
+!>        ranks of the node already, so only the nodes are summed.
+!> \param shm ...
+!> \param DATA ...
+!> \note
+!>      collective on gid, includes the mp_shm_sync needed before and after
+! *****************************************************************************
+  SUBROUTINE mp_shm_sum_lv(shm, DATA)
+    TYPE(mp_shm_type), INTENT(IN)            :: shm
+    INTEGER(KIND=int_8), DIMENSION(:), POINTER           :: DATA
+
+    CHARACTER(len=*), PARAMETER :: routineN = 'mp_shm_sum_lv', &
+      routineP = moduleN//':'//routineN
+
+    INTEGER                                  :: handle, ierr, msglen
+
+    IF (.NOT. shm%by_node) THEN
+       CALL mp_sum(DATA, shm%gid)
+       RETURN
+    END IF
+
+    ierr = 0
+    CALL mp_timeset(routineN,handle)
+
+    CALL mp_shm_sync(shm)
+#if defined(__parallel)
+    t_start = m_walltime ( )
+    msglen = SIZE(DATA)
+    IF (shm%leader_comm /= MPI_COMM_NULL .AND. msglen > 0) THEN
+       CALL mpi_allreduce(MPI_IN_PLACE,DATA,msglen,MPI_INTEGER8,MPI_SUM,shm%leader_comm,ierr)
+       IF ( ierr /= 0 ) CALL mp_stop( ierr, "mpi_allreduce @ "//routineN )
+    END IF
+    t_end = m_walltime ( )
+    CALL add_perf(perf_id=3,count=1,time=t_end-t_start,msg_size=msglen*int_8_size)
+#else
+    msglen = 0
+#endif
+    CALL mp_shm_sync(shm)
+
+    CALL mp_timestop(handle)
+  END SUBROUTINE mp_shm_sum_lv
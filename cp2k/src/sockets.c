@@ -32,6 +32,17 @@ Functions:
       port number.
    write_buffer_: Writes a string to the socket.
    read_buffer_: Reads data from the socket.
+   writevbuffer, readvbuffer: Write or read several buffers, e.g. a header
+      and its payload, with a single system call.
+   open_server_socket: Opens a listening socket, to which several clients
+      can connect when the driver runs in server mode.
+   create_poller, wait_socket, close_client, close_poller: Wait for the next
+      connection or the next message on any of the connected clients, using
+      epoll on Linux and poll elsewhere.
+   readbuffer_status, writebuffer_status, readvbuffer_status,
+      writevbuffer_status: Read or write data like the functions above, but
+      return an error flag instead of exiting if the connection is closed, so
+      that a server only loses the client concerned.
 */
 
 #include <stdio.h>
@@ -43,6 +54,39 @@ Functions:
 #include <netinet/in.h>
 #include <sys/un.h>
 #include <netdb.h>
+#include <errno.h>
+#include <netinet/tcp.h>
+#include <sys/uio.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* maximum number of buffers of writevbuffer and readvbuffer */
+#define MAX_IOV 16
+
+/* requested size of the kernel send and receive buffers, large enough to hold
+   the positions or forces of a big system, so that they are not split into
+   many round trips. The kernel may cap it (net.core.wmem_max/rmem_max). */
+#define SOCKET_BUFFER_SIZE (4*1024*1024)
+
+static void tune_socket(int sockfd)
+/* Disables Nagle's algorithm, which would hold back the small messages of the
+protocol, and enlarges the socket buffers. Failures are harmless and ignored,
+e.g. TCP_NODELAY does not apply to unix domain sockets. */
+
+{
+   int on = 1, size = SOCKET_BUFFER_SIZE;
+
+   setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+   setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+   setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+}
 
 void open_socket(int *psockfd, int* inet, int* port, char* host)
 /* Opens a socket.
@@ -82,6 +126,8 @@ Args:
       // creates socket
       sockfd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
       if (sockfd < 0) { perror("Error opening socket"); exit(-1); }
+      // before connect, so that the TCP window scaling can use the buffer size
+      tune_socket(sockfd);
     
       // makes connection
       if (connect(sockfd, res->ai_addr, res->ai_addrlen) < 0) { perror("Error opening INET socket: wrong port or server unreachable"); exit(-1); }
@@ -99,6 +145,7 @@ Args:
   
       // creates the socket
       sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+      tune_socket(sockfd);
 
       // connects
       if (connect(sockfd, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0) { perror("Error opening UNIX socket: path unavailable, or already existing"); exit(-1); }
@@ -108,6 +155,40 @@ Args:
    *psockfd=sockfd;
 }
 
+/* Transfers the buffers described by iov, continuing after partial reads and
+writes and after interrupted system calls. Returns 0 on success and 1 if the
+connection was closed or broke. Writes use sendmsg with MSG_NOSIGNAL, so that a
+client that has quit does not kill the process with SIGPIPE. */
+static int transfer_iov(int sockfd, struct iovec *iov, int iovcnt, int do_write)
+{
+   ssize_t n;
+   struct msghdr msg;
+
+   while (iovcnt > 0)
+   {  // skips the buffers that are complete, including empty ones
+      if (iov->iov_len == 0) { iov++; iovcnt--; continue; }
+
+      if (do_write)
+      {  memset(&msg, 0, sizeof(msg));
+         msg.msg_iov = iov;
+         msg.msg_iovlen = iovcnt;
+         n = sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+      }
+      else n = readv(sockfd, iov, iovcnt);
+
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return 1;
+
+      while (iovcnt > 0 && (size_t) n >= iov->iov_len)
+      {  n -= iov->iov_len; iov++; iovcnt--; }
+      if (iovcnt > 0)
+      {  iov->iov_base = (char *) iov->iov_base + n;
+         iov->iov_len -= n;
+      }
+   }
+   return 0;
+}
+
 void writebuffer(int *psockfd, char *data, int* plen)
 /* Writes to a socket.
 
@@ -118,12 +199,11 @@ Args:
 */
 
 {
-   int n;
-   int sockfd=*psockfd;
-   int len=*plen;
+   struct iovec iov;
 
-   n = write(sockfd,data,len);
-   if (n < 0) { perror("Error writing to socket: server has quit or connection broke"); exit(-1); }
+   iov.iov_base = data;
+   iov.iov_len = *plen;
+   if (transfer_iov(*psockfd, &iov, 1, 1)) { perror("Error writing to socket: server has quit or connection broke"); exit(-1); }
 }
 
 
@@ -137,16 +217,357 @@ Args:
 */
 
 {
-   int n, nr;
-   int sockfd=*psockfd;
-   int len=*plen;
+   struct iovec iov;
+
+   iov.iov_base = data;
+   iov.iov_len = *plen;
+   if (transfer_iov(*psockfd, &iov, 1, 0)) { perror("Error reading from socket: server has quit or connection broke"); exit(-1); }
+}
+
+static void fill_iov(struct iovec *iov, void **pdata, int *plens, int n)
+{
+   int i;
+
+   if (n > MAX_IOV) { fprintf(stderr, "Too many buffers for a single socket transfer\n"); exit(-1); }
+   for (i = 0; i < n; i++)
+   {  iov[i].iov_base = pdata[i];
+      iov[i].iov_len = plens[i];
+   }
+}
+
+void writevbuffer(int *psockfd, void **pdata, int *plens, int *pn)
+/* Writes several buffers to a socket with a single gathering system call, so
+that a header and its payload leave in one packet.
+
+Args:
+   psockfd: The id of the socket that will be written to.
+   pdata: The addresses of the buffers.
+   plens: The lengths of the buffers in bytes.
+   pn: The number of buffers, at most MAX_IOV.
+*/
+
+{
+   struct iovec iov[MAX_IOV];
+
+   fill_iov(iov, pdata, plens, *pn);
+   if (transfer_iov(*psockfd, iov, *pn, 1)) { perror("Error writing to socket: server has quit or connection broke"); exit(-1); }
+}
+
+void readvbuffer(int *psockfd, void **pdata, int *plens, int *pn)
+/* Reads several buffers from a socket with a single scattering system call,
+the counterpart of writevbuffer.
+
+Args:
+   psockfd: The id of the socket that will be read from.
+   pdata: The addresses of the buffers.
+   plens: The lengths of the buffers in bytes.
+   pn: The number of buffers, at most MAX_IOV.
+*/
+
+{
+   struct iovec iov[MAX_IOV];
+
+   fill_iov(iov, pdata, plens, *pn);
+   if (transfer_iov(*psockfd, iov, *pn, 0)) { perror("Error reading from socket: server has quit or connection broke"); exit(-1); }
+}
+
+/* path of the unix domain socket of the server, removed by close_poller */
+static char server_path[sizeof(((struct sockaddr_un *) 0)->sun_path)] = "";
+
+void open_server_socket(int *psockfd, int* inet, int* port, char* host)
+/* Opens a listening socket.
+
+Args:
+   psockfd: The id of the socket that will be created.
+   inet: Gives a unix domain socket if 0, an inet socket otherwise.
+   port: The port number to listen on.
+   host: The name of the interface to listen on, or the name of the unix
+      domain socket, which is created as /tmp/ipi_host.
+*/
+
+{
+   int sockfd, ai_err, on=1;
+
+   if (*inet>0)
+   {  // creates an internet socket
+      struct addrinfo hints, *res;
+      char service[256];
+
+      memset(&hints, 0, sizeof(hints));
+      hints.ai_socktype = SOCK_STREAM;
+      hints.ai_family = AF_UNSPEC;
+      hints.ai_flags = AI_PASSIVE;
+
+      sprintf(service,"%d",*port);
+      ai_err = getaddrinfo(host, service, &hints, &res);
+      if (ai_err!=0) { perror("Error fetching host data. Wrong host name?"); exit(-1); }
+
+      sockfd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+      if (sockfd < 0) { perror("Error opening socket"); exit(-1); }
+
+      // a restarted server must not wait for the old connections to time out
+      setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+      tune_socket(sockfd);
+      if (bind(sockfd, res->ai_addr, res->ai_addrlen) < 0) { perror("Error binding INET socket: port already in use?"); exit(-1); }
+      freeaddrinfo(res);
+   }
+   else
+   {  // creates a unix socket
+      struct sockaddr_un serv_addr;
+
+      memset(&serv_addr, 0, sizeof(serv_addr));
+      serv_addr.sun_family = AF_UNIX;
+      strcpy(serv_addr.sun_path, "/tmp/ipi_");
+      strncpy(serv_addr.sun_path+9, host, sizeof(serv_addr.sun_path)-10);
 
-   n = nr = read(sockfd,data,len);
+      sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (sockfd < 0) { perror("Error opening socket"); exit(-1); }
+      tune_socket(sockfd);
+
+      // removes the socket left over by a previous run
+      unlink(serv_addr.sun_path);
+      if (bind(sockfd, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0) { perror("Error binding UNIX socket: path unavailable"); exit(-1); }
+      strcpy(server_path, serv_addr.sun_path);
+   }
 
-   while (nr>0 && n<len )
-   {  nr=read(sockfd,&data[n],len-n); n+=nr; }
+   if (listen(sockfd, SOMAXCONN) < 0) { perror("Error listening on socket"); exit(-1); }
 
-   if (n == 0) { perror("Error reading from socket: server has quit or connection broke"); exit(-1); }
+   *psockfd=sockfd;
 }
 
+#if !defined(__linux__)
+/* descriptors watched by poll, the first one is the listening socket */
+#define MAX_POLL_FDS 1024
+static struct pollfd poll_fds[MAX_POLL_FDS];
+static int n_poll_fds = 0, next_poll_fd = 0;
+#endif
+
+void create_poller(int *ppoller, int *psockfd)
+/* Creates the set of sockets that wait_socket waits on.
 
+Args:
+   ppoller: The id of the created set.
+   psockfd: The listening socket, which is the first member of the set.
+*/
+
+{
+#if defined(__linux__)
+   struct epoll_event event;
+   int epfd;
+
+   epfd = epoll_create(16);
+   if (epfd < 0) { perror("Error creating epoll instance"); exit(-1); }
+   memset(&event, 0, sizeof(event));
+   event.events = EPOLLIN;
+   event.data.fd = *psockfd;
+   if (epoll_ctl(epfd, EPOLL_CTL_ADD, *psockfd, &event) < 0) { perror("Error adding socket to epoll instance"); exit(-1); }
+   *ppoller = epfd;
+#else
+   poll_fds[0].fd = *psockfd;
+   poll_fds[0].events = POLLIN;
+   n_poll_fds = 1;
+   next_poll_fd = 0;
+   *ppoller = 0;
+#endif
+}
+
+static void add_to_poller(int poller, int sockfd)
+{
+#if defined(__linux__)
+   struct epoll_event event;
+
+   memset(&event, 0, sizeof(event));
+   event.events = EPOLLIN;
+   event.data.fd = sockfd;
+   if (epoll_ctl(poller, EPOLL_CTL_ADD, sockfd, &event) < 0) { perror("Error adding socket to epoll instance"); exit(-1); }
+#else
+   (void) poller;
+   if (n_poll_fds >= MAX_POLL_FDS) { fprintf(stderr, "Too many clients\n"); exit(-1); }
+   poll_fds[n_poll_fds].fd = sockfd;
+   poll_fds[n_poll_fds].events = POLLIN;
+   poll_fds[n_poll_fds].revents = 0;
+   n_poll_fds++;
+#endif
+}
+
+void wait_socket(int *ppoller, int *psockfd, int *ptimeout, int *pfd, int *pnew)
+/* Waits until a client connects or a connected client has data to be read.
+
+New connections are accepted and added to the set right away. Level triggered
+events are used, so that a client that still has data is reported again by the
+next call, after the clients that became ready in the meantime.
+
+Args:
+   ppoller: The set of sockets to wait on.
+   psockfd: The listening socket.
+   ptimeout: The time to wait in milliseconds, -1 to wait forever.
+   pfd: The socket that is ready, or -1 if the time is out.
+   pnew: 1 if pfd was accepted by this call, 0 otherwise.
+*/
+
+{
+   int fd = -1, nready;
+
+   *pfd = -1;
+   *pnew = 0;
+#if defined(__linux__)
+   {
+      struct epoll_event event;
+
+      do nready = epoll_wait(*ppoller, &event, 1, *ptimeout);
+      while (nready < 0 && errno == EINTR);
+      if (nready < 0) { perror("Error waiting on sockets"); exit(-1); }
+      if (nready > 0) fd = event.data.fd;
+   }
+#else
+   {
+      int i, j;
+
+      do nready = poll(poll_fds, n_poll_fds, *ptimeout);
+      while (nready < 0 && errno == EINTR);
+      if (nready < 0) { perror("Error waiting on sockets"); exit(-1); }
+      // round robin over the ready sockets
+      for (i = 0; i < n_poll_fds && nready > 0; i++)
+      {  j = (next_poll_fd + i) % n_poll_fds;
+         if (poll_fds[j].revents)
+         {  fd = poll_fds[j].fd;
+            next_poll_fd = (j + 1) % n_poll_fds;
+            break;
+         }
+      }
+   }
+#endif
+   if (fd < 0) return;
+
+   if (fd == *psockfd)
+   {  fd = accept(*psockfd, NULL, NULL);
+      if (fd < 0) { perror("Error accepting connection"); exit(-1); }
+      tune_socket(fd);
+      add_to_poller(*ppoller, fd);
+      *pnew = 1;
+   }
+   *pfd = fd;
+}
+
+void close_client(int *ppoller, int *pfd)
+/* Removes a client from the set and closes its connection.
+
+Args:
+   ppoller: The set of sockets.
+   pfd: The socket of the client.
+*/
+
+{
+#if defined(__linux__)
+   struct epoll_event event;
+
+   epoll_ctl(*ppoller, EPOLL_CTL_DEL, *pfd, &event);
+#else
+   int i;
+
+   (void) ppoller;
+   for (i = 1; i < n_poll_fds; i++)
+      if (poll_fds[i].fd == *pfd)
+      {  poll_fds[i] = poll_fds[--n_poll_fds];
+         break;
+      }
+#endif
+   close(*pfd);
+}
+
+void close_poller(int *ppoller, int *psockfd)
+/* Closes the set of sockets and the listening socket.
+
+Args:
+   ppoller: The set of sockets.
+   psockfd: The listening socket.
+*/
+
+{
+#if defined(__linux__)
+   close(*ppoller);
+#else
+   (void) ppoller;
+   n_poll_fds = 0;
+#endif
+   close(*psockfd);
+   if (server_path[0] != 0) { unlink(server_path); server_path[0] = 0; }
+}
+
+void readbuffer_status(int *psockfd, char *data, int* plen, int* pstatus)
+/* Reads from a socket like readbuffer, but does not exit if the connection
+is closed.
+
+Args:
+   psockfd: The id of the socket that will be read from.
+   data: The storage array for data read from the socket.
+   plen: The length of the data in bytes.
+   pstatus: 0 on success, 1 if the connection was closed before plen bytes
+      could be read.
+*/
+
+{
+   struct iovec iov;
+
+   iov.iov_base = data;
+   iov.iov_len = *plen;
+   *pstatus = transfer_iov(*psockfd, &iov, 1, 0);
+}
+
+void writebuffer_status(int *psockfd, char *data, int* plen, int* pstatus)
+/* Writes to a socket like writebuffer, but does not exit if the connection
+is closed.
+
+Args:
+   psockfd: The id of the socket that will be written to.
+   data: The data to be written to the socket.
+   plen: The length of the data in bytes.
+   pstatus: 0 on success, 1 if the connection was closed or broke.
+*/
+
+{
+   struct iovec iov;
+
+   iov.iov_base = data;
+   iov.iov_len = *plen;
+   *pstatus = transfer_iov(*psockfd, &iov, 1, 1);
+}
+
+void readvbuffer_status(int *psockfd, void **pdata, int *plens, int *pn, int* pstatus)
+/* Reads several buffers like readvbuffer, but does not exit if the
+connection is closed.
+
+Args:
+   psockfd: The id of the socket that will be read from.
+   pdata: The addresses of the buffers.
+   plens: The lengths of the buffers in bytes.
+   pn: The number of buffers, at most MAX_IOV.
+   pstatus: 0 on success, 1 if the connection was closed before all buffers
+      could be read.
+*/
+
+{
+   struct iovec iov[MAX_IOV];
+
+   fill_iov(iov, pdata, plens, *pn);
+   *pstatus = transfer_iov(*psockfd, iov, *pn, 0);
+}
+
+void writevbuffer_status(int *psockfd, void **pdata, int *plens, int *pn, int* pstatus)
+/* Writes several buffers like writevbuffer, but does not exit if the
+connection is closed.
+
+Args:
+   psockfd: The id of the socket that will be written to.
+   pdata: The addresses of the buffers.
+   plens: The lengths of the buffers in bytes.
+   pn: The number of buffers, at most MAX_IOV.
+   pstatus: 0 on success, 1 if the connection was closed or broke.
+*/
+
+{
+   struct iovec iov[MAX_IOV];
+
+   fill_iov(iov, pdata, plens, *pn);
+   *pstatus = transfer_iov(*psockfd, iov, *pn, 1);
+}
@@ -0,0 +1,252 @@
+/*****************************************************************************
+ *  CP2K: A general program to perform molecular dynamics simulations        *
+ *  Copyright (C) 2000 - 2014 the CP2K developers group                      *
+ *****************************************************************************/
+
+/* Queue of asynchronous evaluations of force environments, see libcp2k.h.
+
+   The evaluations of a process are kept in a FIFO list and run one after the
+   other by a single worker thread, which is started with the first
+   submission. CP2K itself is not reentrant, so there is never more than one
+   evaluation running in a process; the concurrency comes from the disjoint
+   process groups, which run their evaluations at the same time, and from the
+   host threads, which go on while the worker computes.
+   The worker calls MPI next to the host threads, which needs
+   MPI_THREAD_MULTIPLE. Without it (cp_batch_threaded), as well as without
+   pthreads, the evaluations are run in the calling thread by
+   cp2k_batch_wait, cp2k_batch_test and cp2k_batch_wait_all instead.
+   The evaluation itself is cp_batch_eval of f77_int_low.F. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(__NO_PTHREADS)
+#include <pthread.h>
+#include <sys/resource.h>
+#endif
+
+#include "libcp2k.h"
+
+/* CP2K allocates large arrays on the stack, so the worker thread gets at least
+   the stack size of the main thread */
+#define MIN_WORKER_STACK (64*1024*1024)
+
+void cp_batch_eval(int env_id, const double *pos, int n_el, double *energy,
+                   double *forces, double *stress, int *ierr);
+int cp_batch_threaded(void);
+
+struct cp2k_request {
+   int env_id, n_el;
+   const double *pos;
+   double *energy, *forces, *stress;
+   int *ierr;
+   int my_ierr;          /* used if the caller passed no ierr */
+   int done;
+   int has_handle;       /* released by cp2k_batch_wait, else by the worker */
+   struct cp2k_request *next;
+};
+
+static cp2k_request *queue_head = NULL, *queue_tail = NULL;
+static int n_pending = 0, n_failed = 0;
+
+#if !defined(__NO_PTHREADS)
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+/* serializes the evaluations run by the calling threads */
+static pthread_mutex_t run_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t worker;
+static int worker_running = 0, worker_stop = 0;
+/* decided with the first submission, -1 until then */
+static int synchronous = -1;
+#define LOCK() pthread_mutex_lock(&queue_mutex)
+#define UNLOCK() pthread_mutex_unlock(&queue_mutex)
+#define SYNCHRONOUS (synchronous > 0)
+#else
+#define LOCK()
+#define UNLOCK()
+#define SYNCHRONOUS 1
+#endif
+
+/* takes the first request off the queue, the lock has to be held */
+static cp2k_request *pop_request(void){
+   cp2k_request *req = queue_head;
+
+   if (req){
+      queue_head = req->next;
+      if (!queue_head) queue_tail = NULL;
+   }
+   return req;
+}
+
+/* runs the evaluation, then marks it done; called without the lock */
+static void run_request(cp2k_request *req){
+   cp_batch_eval(req->env_id, req->pos, req->n_el, req->energy,
+                 req->forces, req->stress, req->ierr);
+
+   LOCK();
+   if (*req->ierr != 0) n_failed++;
+   n_pending--;
+   req->done = 1;
+   if (!req->has_handle) free(req);
+#if !defined(__NO_PTHREADS)
+   pthread_cond_broadcast(&queue_cond);
+#endif
+   UNLOCK();
+}
+
+#if !defined(__NO_PTHREADS)
+static void *worker_main(void *arg){
+   cp2k_request *req;
+
+   (void) arg;
+   for (;;){
+      LOCK();
+      while (!queue_head && !worker_stop) pthread_cond_wait(&queue_cond, &queue_mutex);
+      req = pop_request();
+      UNLOCK();
+      if (!req) break;
+      run_request(req);
+   }
+   return NULL;
+}
+
+/* starts the worker thread, the lock has to be held */
+static int start_worker(void){
+   pthread_attr_t attr;
+   struct rlimit limit;
+   size_t stack_size = MIN_WORKER_STACK;
+   int err;
+
+   if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+       limit.rlim_cur > stack_size) stack_size = limit.rlim_cur;
+   pthread_attr_init(&attr);
+   pthread_attr_setstacksize(&attr, stack_size);
+   err = pthread_create(&worker, &attr, worker_main, NULL);
+   pthread_attr_destroy(&attr);
+   if (err) return -1;
+   worker_running = 1;
+   worker_stop = 0;
+   return 0;
+}
+#endif
+
+/* runs the queued evaluations in the calling thread until req (or all of them
+   if NULL) is done */
+static void run_queue(cp2k_request *req){
+   cp2k_request *next;
+
+#if !defined(__NO_PTHREADS)
+   pthread_mutex_lock(&run_mutex);
+#endif
+   for (;;){
+      LOCK();
+      next = (!req || !req->done) ? pop_request() : NULL;
+      UNLOCK();
+      if (!next) break;
+      run_request(next);
+   }
+#if !defined(__NO_PTHREADS)
+   pthread_mutex_unlock(&run_mutex);
+#endif
+}
+
+int cp2k_batch_submit(int env_id, const double *pos, int n_el, double *energy,
+                      double *forces, double *stress, int *ierr,
+                      cp2k_request **request){
+   cp2k_request *req;
+
+   if (!pos || !energy || n_el < 0) return -1;
+   req = (cp2k_request *) malloc(sizeof(cp2k_request));
+   if (!req) return -1;
+   req->env_id = env_id;
+   req->n_el = n_el;
+   req->pos = pos;
+   req->energy = energy;
+   req->forces = forces;
+   req->stress = stress;
+   req->my_ierr = 0;
+   req->ierr = ierr ? ierr : &req->my_ierr;
+   req->done = 0;
+   req->has_handle = (request != NULL);
+   req->next = NULL;
+
+   LOCK();
+#if !defined(__NO_PTHREADS)
+   if (synchronous < 0) synchronous = !cp_batch_threaded();
+   if (!synchronous && !worker_running && start_worker() != 0){
+      UNLOCK();
+      free(req);
+      return -1;
+   }
+#endif
+   if (queue_tail) queue_tail->next = req;
+   else queue_head = req;
+   queue_tail = req;
+   n_pending++;
+#if !defined(__NO_PTHREADS)
+   pthread_cond_broadcast(&queue_cond);
+#endif
+   UNLOCK();
+
+   if (request) *request = req;
+   return 0;
+}
+
+int cp2k_batch_wait(cp2k_request *request){
+   int ierr;
+
+   if (!request) return -1;
+   if (SYNCHRONOUS){
+      run_queue(request);
+   } else {
+#if !defined(__NO_PTHREADS)
+      LOCK();
+      while (!request->done) pthread_cond_wait(&queue_cond, &queue_mutex);
+      UNLOCK();
+#endif
+   }
+   ierr = *request->ierr;
+   free(request);
+   return ierr;
+}
+
+int cp2k_batch_test(cp2k_request *request){
+   int done;
+
+   if (!request) return 1;
+   if (SYNCHRONOUS) run_queue(request);
+   LOCK();
+   done = request->done;
+   UNLOCK();
+   return done;
+}
+
+int cp2k_batch_wait_all(void){
+   int failed;
+
+   if (SYNCHRONOUS) run_queue(NULL);
+   LOCK();
+#if !defined(__NO_PTHREADS)
+   while (n_pending > 0) pthread_cond_wait(&queue_cond, &queue_mutex);
+#endif
+   failed = n_failed;
+   n_failed = 0;
+   UNLOCK();
+   return failed;
+}
+
+void cp2k_batch_finalize(void){
+   cp2k_batch_wait_all();
+#if !defined(__NO_PTHREADS)
+   LOCK();
+   if (!worker_running){
+      UNLOCK();
+      return;
+   }
+   worker_stop = 1;
+   pthread_cond_broadcast(&queue_cond);
+   UNLOCK();
+   pthread_join(worker, NULL);
+   worker_running = 0;
+#endif
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ *  CP2K: A general program to perform molecular dynamics simulations        *
+ *  Copyright (C) 2000 - 2014 the CP2K developers group                      *
+ *****************************************************************************/
+
+/* C interface to use CP2K as a library.
+
+   The environment routines are the C bindings of the ones in f77_int_low.F,
+   see f77_interface.F for their description. All of them return the error
+   code in ierr, which is zero on success.
+
+   The batch routines (cp2k_batch.c) queue evaluations of force environments
+   and run them asynchronously in a worker thread of the calling process, so
+   that the host application can prepare the next geometries meanwhile.
+   To evaluate several environments concurrently, split the MPI processes into
+   disjoint groups (e.g. with cp2k_split_world), create one environment per
+   group on the group communicator, and let every group submit the
+   evaluations of its own environment. All processes of a group have to submit
+   the same evaluations in the same order, as they are run collectively.
+
+   The buffers are not copied: pos is read and energy, forces, stress and ierr
+   are written when the evaluation runs, so they have to stay valid (and pos
+   unchanged) until the evaluation has completed.
+
+   The batch routines may be called from several threads of the host
+   application. Evaluations of a process are run one at a time in submission
+   order. While evaluations are pending, no other routine of this header may
+   be called. With MPI, the worker thread communicates while the host threads
+   may do so as well, so it is only used if MPI provides MPI_THREAD_MULTIPLE
+   (requested by cp2k_init if it initializes MPI and CP2K is compiled with
+   -D__MPI_THREAD_MULTIPLE). Otherwise, as well as if CP2K is compiled with
+   -D__NO_PTHREADS, the evaluations are run in the calling thread by
+   cp2k_batch_wait, cp2k_batch_test and cp2k_batch_wait_all, which then have
+   to be called from the thread that initialized MPI. */
+
+#ifndef LIBCP2K_H
+#define LIBCP2K_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* environments */
+void cp2k_init(int init_mpi, int *ierr);
+void cp2k_finalize(int finalize_mpi, int *ierr);
+/* f_comm is a Fortran MPI communicator (MPI_Comm_c2f), or -1 for all
+   processes */
+void cp2k_create_env(int *env_id, const char *input_path, const char *output_path,
+                     int f_comm, int *ierr);
+void cp2k_destroy_env(int env_id, int *ierr);
+void cp2k_get_natom(int env_id, int *natom, int *ierr);
+void cp2k_get_pos(int env_id, double *pos, int n_el, int *ierr);
+/* splits the processes into ngroups groups of consecutive ranks, returns
+   the Fortran communicator of the group of the caller and its index */
+void cp2k_split_world(int ngroups, int *f_comm, int *group, int *ierr);
+/* frees a communicator of cp2k_split_world, after the environments created
+   on it have been destroyed */
+void cp2k_free_comm(int f_comm, int *ierr);
+
+/* batched evaluations */
+typedef struct cp2k_request cp2k_request;
+
+/* Queues the evaluation of env_id at the positions pos (3*natom values,
+   atomic units). forces (3*natom values) and stress (9 values) may be NULL,
+   without forces only the energy is computed. If request is not NULL, it
+   receives a handle that has to be passed to cp2k_batch_wait, otherwise the
+   completion is only known after cp2k_batch_wait_all.
+   Returns zero on success. */
+int cp2k_batch_submit(int env_id, const double *pos, int n_el, double *energy,
+                      double *forces, double *stress, int *ierr,
+                      cp2k_request **request);
+
+/* Waits for the evaluation, releases the handle and returns its ierr. */
+int cp2k_batch_wait(cp2k_request *request);
+
+/* Returns 1 if the evaluation has completed, 0 otherwise. The handle stays
+   valid until it is passed to cp2k_batch_wait. */
+int cp2k_batch_test(cp2k_request *request);
+
+/* Waits until all evaluations submitted by the process have completed.
+   Returns the number of them that failed since the last call. */
+int cp2k_batch_wait_all(void);
+
+/* Waits for all evaluations and stops the worker thread, to be called
+   before cp2k_finalize. */
+void cp2k_batch_finalize(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
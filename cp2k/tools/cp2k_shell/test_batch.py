@@ -0,0 +1,155 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+# Checks the binary channel and CALC_EF_BATCH of cp2k_shell.
+#
+# usage: test_batch.py <cp2k_shell executable> [input]
+#
+# The geometries and results go through two named pipes in a temporary
+# directory. The test checks that
+#  - the results of a batch agree with CALC_EF and arrive one per geometry,
+#  - an empty batch replies 0 and writes nothing to the binary channel,
+#  - the binary channel stays in sync over several batches.
+# It exits with a non-zero status if a check fails.
+
+from __future__ import print_function
+
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+
+EPS = 1.0e-10
+
+#=============================================================================
+def main():
+    if len(sys.argv) not in (2, 3):
+        print("Usage: test_batch.py <cp2k_shell executable> [input]")
+        sys.exit(1)
+    shell_exe = os.path.abspath(sys.argv[1])
+    if len(sys.argv) == 3:
+        inp = os.path.abspath(sys.argv[2])
+    else:
+        inp = os.path.join(os.path.dirname(os.path.abspath(__file__)), "water.inp")
+
+    tmp_dir = tempfile.mkdtemp(prefix="cp2k_shell_")
+    try:
+        failed = run_test(shell_exe, inp, tmp_dir)
+    finally:
+        shutil.rmtree(tmp_dir)
+    if failed:
+        print("cp2k_shell batch test FAILED")
+        sys.exit(1)
+    print("cp2k_shell batch test OK")
+
+#=============================================================================
+def run_test(shell_exe, inp, tmp_dir):
+    bin_in = os.path.join(tmp_dir, "bin_in")
+    bin_out = os.path.join(tmp_dir, "bin_out")
+    os.mkfifo(bin_in)
+    os.mkfifo(bin_out)
+
+    shell = Shell(shell_exe, tmp_dir)
+    shell.command("LOAD %s %s" % (inp, os.path.join(tmp_dir, "shell.out")))
+    natom = int(shell.command("NATOM")[0])
+    nval = 1 + 3*natom + 9
+
+    # the shell opens bin_in first, the pipes block until both ends are open
+    shell.send("BIN_OPEN %s %s" % (bin_in, bin_out))
+    f_in = open(bin_in, "wb", 0)
+    f_out = open(bin_out, "rb", 0)
+    shell.reply()
+
+    lines = shell.command("GET_POS")
+    pos = [float(x) for x in " ".join(lines[1:-1]).split()]
+    lines = shell.command("CALC_EF")
+    e_ref = float(lines[0])
+    f_ref = [float(x) for x in " ".join(lines[2:-1]).split()]
+
+    failed = False
+    shifted = [x + 0.01 for x in pos]
+    for geoms in ([], [pos, shifted], [], [shifted, pos, shifted]):
+        writer = threading.Thread(target=write_geoms, args=(f_in, geoms))
+        writer.start()
+        shell.send("CALC_EF_BATCH %d" % len(geoms))
+        results = [read_values(f_out, nval) for g in geoms]
+        writer.join()
+        lines = shell.reply()
+        if lines != ["%10d" % len(geoms)]:
+            print("batch of %d: unexpected reply %s" % (len(geoms), lines))
+            failed = True
+        for g, res in zip(geoms, results):
+            if g is pos:
+                if abs(res[0] - e_ref) > EPS or \
+                   max(abs(a - b) for a, b in zip(res[1:1+3*natom], f_ref)) > EPS:
+                    print("batch of %d: results differ from CALC_EF" % len(geoms))
+                    failed = True
+
+    # after all batches nothing must be left in the binary output
+    shell.send("BIN_CLOSE")
+    if f_out.read(1):
+        print("extra data on the binary channel")
+        failed = True
+    shell.reply()
+    f_in.close()
+    f_out.close()
+    shell.send("EXIT")
+    shell.wait()
+    return failed
+
+#=============================================================================
+def write_geoms(f_in, geoms):
+    for g in geoms:
+        f_in.write(struct.pack("%dd" % len(g), *g))
+
+#=============================================================================
+def read_values(f_out, nval):
+    data = b""
+    while len(data) < 8*nval:
+        chunk = f_out.read(8*nval - len(data))
+        if not chunk:
+            raise Exception("binary channel closed")
+        data += chunk
+    return struct.unpack("%dd" % nval, data)
+
+#=============================================================================
+class Shell(object):
+    def __init__(self, exe, cwd):
+        self.proc = subprocess.Popen([exe], cwd=cwd, stdin=subprocess.PIPE,
+                                     stdout=subprocess.PIPE,
+                                     universal_newlines=True)
+        self.reply()
+
+    def send(self, cmd):
+        self.proc.stdin.write(cmd + "\n")
+        self.proc.stdin.flush()
+
+    def reply(self):
+        """ the lines of the reply up to the prompt """
+        lines = []
+        while True:
+            line = self.proc.stdout.readline()
+            if not line:
+                raise Exception("cp2k_shell terminated")
+            line = line.rstrip("\n")
+            if line == "* READY":
+                return lines
+            if line.startswith("* ERROR"):
+                raise Exception("cp2k_shell: " + line)
+            lines.append(line)
+
+    def command(self, cmd):
+        self.send(cmd)
+        return self.reply()
+
+    def wait(self):
+        self.proc.stdin.close()
+        self.proc.wait()
+
+#=============================================================================
+main()
+
+#EOF
@@ -0,0 +1,119 @@
+/*****************************************************************************
+ *  CP2K: A general program to perform molecular dynamics simulations        *
+ *  Copyright (C) 2000 - 2014 the CP2K developers group                      *
+ *****************************************************************************/
+
+/* Example of the batch interface of libcp2k.h.
+
+   The processes are split into ngroups groups (first argument, default 1),
+   each of which loads "input.inp" into its own force environment. The
+   finite difference forces of all coordinates are computed with the
+   displaced geometries distributed round robin over the groups, which
+   evaluate them concurrently. Every group submits all of its geometries
+   first and then waits for them, so that it could prepare further work in
+   the meantime. Finally the finite difference forces are compared with the
+   analytic ones.
+
+   It has to be linked against the CP2K libraries like the Fortran examples,
+   e.g. for a parallel build
+     mpicc -D__parallel -I../../src/start c_batch.c -L../../lib/ARCH/popt \
+        -lcp2k ... -lgfortran
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__parallel)
+#include <mpi.h>
+#endif
+
+#include "libcp2k.h"
+
+#define DELTA 1.0e-3
+
+int main(int argc, char **argv){
+   int ngroups = 1, group, f_comm, env_id, natom, n_el, ierr, i, j, n_mine;
+   int rank = 0, failed;
+   double *pos, *forces, *disp, *e_plus, *e_minus, e0, err, err_max = 0.0;
+   char out_name[64];
+#if defined(__parallel)
+   double *buf;
+#endif
+
+   if (argc > 1) ngroups = atoi(argv[1]);
+
+   cp2k_init(1, &ierr);
+   if (ierr) { fprintf(stderr, "cp2k_init failed\n"); return 1; }
+   cp2k_split_world(ngroups, &f_comm, &group, &ierr);
+   if (ierr) { fprintf(stderr, "cp2k_split_world failed\n"); return 1; }
+#if defined(__parallel)
+   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#endif
+
+   sprintf(out_name, "c_batch_%d.out", group);
+   cp2k_create_env(&env_id, "input.inp", out_name, f_comm, &ierr);
+   if (ierr) { fprintf(stderr, "cp2k_create_env failed\n"); return 1; }
+   cp2k_get_natom(env_id, &natom, &ierr);
+   n_el = 3*natom;
+
+   pos = (double *) malloc(n_el*sizeof(double));
+   forces = (double *) malloc(n_el*sizeof(double));
+   disp = (double *) malloc(2*n_el*n_el*sizeof(double));
+   e_plus = (double *) calloc(n_el, sizeof(double));
+   e_minus = (double *) calloc(n_el, sizeof(double));
+
+   /* the analytic forces at the reference geometry */
+   cp2k_get_pos(env_id, pos, n_el, &ierr);
+   if (cp2k_batch_submit(env_id, pos, n_el, &e0, forces, NULL, &ierr, NULL)) return 1;
+
+   /* the displaced geometries of this group, all in flight at once */
+   n_mine = 0;
+   for (i = group; i < n_el; i += ngroups){
+      for (j = 0; j < n_el; j++){
+         disp[(2*i)*n_el + j] = pos[j];
+         disp[(2*i + 1)*n_el + j] = pos[j];
+      }
+      disp[(2*i)*n_el + i] += DELTA;
+      disp[(2*i + 1)*n_el + i] -= DELTA;
+      cp2k_batch_submit(env_id, &disp[(2*i)*n_el], n_el, &e_plus[i], NULL, NULL, NULL, NULL);
+      cp2k_batch_submit(env_id, &disp[(2*i + 1)*n_el], n_el, &e_minus[i], NULL, NULL, NULL, NULL);
+      n_mine++;
+   }
+
+   failed = cp2k_batch_wait_all();
+   if (failed) { fprintf(stderr, "%d evaluations failed\n", failed); return 1; }
+
+#if defined(__parallel)
+   /* every group holds the energies of its coordinates, the others are 0.
+      Only the root of each group contributes, so that they count once */
+   {
+      int group_rank;
+      MPI_Comm_rank(MPI_Comm_f2c(f_comm), &group_rank);
+      if (group_rank != 0) for (i = 0; i < n_el; i++) e_plus[i] = e_minus[i] = 0.0;
+   }
+   buf = (double *) malloc(n_el*sizeof(double));
+   MPI_Allreduce(e_plus, buf, n_el, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+   for (i = 0; i < n_el; i++) e_plus[i] = buf[i];
+   MPI_Allreduce(e_minus, buf, n_el, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+   for (i = 0; i < n_el; i++) e_minus[i] = buf[i];
+   free(buf);
+#endif
+
+   for (i = 0; i < n_el; i++){
+      err = fabs(forces[i] + (e_plus[i] - e_minus[i])/(2.0*DELTA));
+      if (err > err_max) err_max = err;
+   }
+   if (rank == 0){
+      printf("groups %d, evaluations of group 0 %d\n", ngroups, 2*n_mine + 1);
+      printf("energy %20.12f\n", e0);
+      printf("max error of the finite difference forces %12.4e\n", err_max);
+   }
+
+   free(pos); free(forces); free(disp); free(e_plus); free(e_minus);
+   cp2k_batch_finalize();
+   cp2k_destroy_env(env_id, &ierr);
+   cp2k_free_comm(f_comm, &ierr);
+   cp2k_finalize(1, &ierr);
+   return 0;
+}